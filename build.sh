@@ -1,56 +1,102 @@
 #!/bin/bash
 cd "$(dirname "$0")"
 
-[ "$1" == "--force" ] && (./reset.sh || exit $?)
+# Build modes:
+#   (default)  i386/x86_64 universal archives for OS X (lipo)
+#   --linux    optimized static + shared libraries for Linux
+#   --pgo      --linux, plus profile-guided optimization: build instrumented
+#              libraries, run tools/train over $PGO_CORPUS, then rebuild
+#              using the collected profile
+#   --multiversion
+#              also build CPU-feature specific variants which are selected
+#              at load time: on Linux, lib/glibc-hwcaps/<level>/libcss.so.0
+#              for each of $HWCAPS_LEVELS (default x86-64-v3); on OS X, an
+#              additional x86_64h slice in the universal archives
+#   --bench    after building, run the tools/bench* benchmarks and write
+#              the results to bench_output.txt. If $BENCH_BASELINE names a
+#              previous bench_output.txt, fail on significant regressions.
+BUILD_MODE=universal
+PGO=0
+MULTIVERSION=0
+BENCH=0
+while [ $# -gt 0 ]; do
+  case "$1" in
+    --force) ./reset.sh || exit $? ;;
+    --linux) BUILD_MODE=linux ;;
+    --pgo) BUILD_MODE=linux; PGO=1 ;;
+    --multiversion) MULTIVERSION=1 ;;
+    --bench) BENCH=1 ;;
+    *)
+      echo "usage: $0 [--force] [--linux] [--pgo] [--multiversion] [--bench]" >&2
+      exit 1
+      ;;
+  esac
+  shift
+done
 
 # --------------------------------------------------------------------------
 # checkout
 
+# written to include/css-revision.h as CSS_LIBCSS_REVISION, which invalidates
+# compiled stylesheet files written against another revision
 NETSURF_SVN_REV=11123
-if [ ! -d libparserutils ]; then
-  if ! (svn co svn://svn.netsurf-browser.org/trunk/libparserutils@$NETSURF_SVN_REV) ; then
-    S=$?
-    rm -rf libparserutils
-    exit $S
-  fi
-fi
-if [ ! -d libwapcaplet ]; then
-  if ! (svn co svn://svn.netsurf-browser.org/trunk/libwapcaplet@$NETSURF_SVN_REV) ; then
-    S=$?
-    rm -rf libparserutils
-    exit $S
-  fi
-fi
-if [ ! -d libcss ]; then
-  if ! (svn co svn://svn.netsurf-browser.org/trunk/libcss@$NETSURF_SVN_REV) ; then
+
+# Optional source tarballs, named <lib>-r$NETSURF_SVN_REV.tar.gz, each
+# containing a single top-level <lib> directory. None are shipped; when
+# present they are used instead of svn, e.g. for building without network.
+VENDOR_DIR=${VENDOR_DIR:-vendor}
+
+function checkout {
+  [ -d $1 ] && return 0
+  tarball="$VENDOR_DIR/$1-r$NETSURF_SVN_REV.tar.gz"
+  if [ -f "$tarball" ]; then
+    if ! (tar -xzf "$tarball") || [ ! -d $1 ]; then
+      echo "$0: failed to unpack $tarball" >&2
+      rm -rf $1
+      exit 1
+    fi
+  elif ! (svn co svn://svn.netsurf-browser.org/trunk/$1@$NETSURF_SVN_REV) ; then
     S=$?
-    rm -rf libparserutils
+    rm -rf $1
     exit $S
   fi
   # apply patches
-  for patchfile in patches/libcss/*.patch; do
-    patch -p0 -d libcss --backup-if-mismatch -i "../$patchfile" || exit $?
+  for patchfile in patches/$1/*.patch; do
+    [ -f "$patchfile" ] || continue
+    patch -p0 -d $1 --backup-if-mismatch -i "../$patchfile" || exit $?
   done
-fi
+}
+
+checkout libparserutils
+checkout libwapcaplet
+checkout libcss
 
 # --------------------------------------------------------------------------
 
 export PKG_CONFIG_PATH="$(pwd)/libparserutils:$(pwd)/libwapcaplet:$PKG_CONFIG_PATH"
 deps_changed=0
 
+# Slices of the universal archives. --multiversion adds x86_64h (Haswell:
+# AVX2, BMI, FMA), which the linker and dyld prefer on capable hosts.
+UNIVERSAL_ARCHS="i386 x86_64"
+
 function isuptodate {
-  [ -f lib/$2 ] && \
-    (make -C $1 -q TARGET=i386 2>/dev/null) && \
-    (make -C $1 -q TARGET=x86_64 2>/dev/null)
+  [ -f lib/$2 ] || return 1
+  for arch in $UNIVERSAL_ARCHS; do
+    (make -C $1 -q TARGET=$arch 2>/dev/null) || return 1
+  done
 }
 
 function makeuniversal {
   origd="$(pwd)"
   cd $1
-  CFLAGS="$CFLAGS -arch i386 $3" make TARGET=i386 || exit $?
-  CFLAGS="$CFLAGS -arch x86_64 $3" make TARGET=x86_64 || exit $?
+  slices=
+  for arch in $UNIVERSAL_ARCHS; do
+    CFLAGS="$CFLAGS -arch $arch $3" make TARGET=$arch || exit $?
+    slices="$slices $(ls -d build-*-$arch-*)/$2"
+  done
   rm -f ../lib/$2
-  lipo build-*i386*/$2 build-*x86_64*/$2 -output ../lib/$2 -create
+  lipo $slices -output ../lib/$2 -create
   ranlib ../lib/$2
   cd "$origd"
 }
@@ -62,53 +108,308 @@ function makeuniversal_ifdirty {
   fi
 }
 
-mkdir -p lib
+# Linux: each archive is built from fat LTO objects (so both our shared
+# object and static consumers linking with -flto get cross-library inlining),
+# using gcc-ar/gcc-ranlib which understand the LTO plugin.
+LINUX_CFLAGS=${LINUX_CFLAGS:-"-O3 -flto -ffat-lto-objects -fPIC -DNDEBUG"}
+LINUX_MAKEFLAGS="AR=gcc-ar RANLIB=gcc-ranlib"
+
+function isuptodate_linux {
+  [ -f lib/$2 ] && (make -C $1 -q TARGET=linux $LINUX_MAKEFLAGS 2>/dev/null)
+}
 
-echo '------------------- libwapcaplet -------------------'
-ln -fs ../libwapcaplet.pc libwapcaplet/libwapcaplet.pc
-makeuniversal_ifdirty libwapcaplet libwapcaplet.a
-lipo -info lib/libwapcaplet.a
+function makelinux {
+  origd="$(pwd)"
+  cd $1
+  CFLAGS="$CFLAGS $LINUX_CFLAGS $3" make TARGET=linux $LINUX_MAKEFLAGS \
+      || exit $?
+  rm -f ../lib/$2
+  cp build-*linux*/$2 ../lib/$2 || exit $?
+  gcc-ranlib ../lib/$2
+  cd "$origd"
+}
 
-echo '------------------- libparserutils -------------------'
-ln -fs ../libparserutils.pc libparserutils/libparserutils.pc
-makeuniversal_ifdirty libparserutils libparserutils.a
-lipo -info lib/libparserutils.a
+function makelinux_ifdirty {
+  if ! (isuptodate_linux $1 $2); then
+    makelinux $1 $2
+    deps_changed=1
+  fi
+}
 
-echo '------------------- libcss -------------------'
-if ! (isuptodate libcss libcss.a) || [ "$deps_changed" = "1" ]; then
-  makeuniversal libcss libcss.a \
-      '-I../libparserutils/include -I../libwapcaplet/include -L..'
-fi
-lipo -info lib/libcss.a
+# Link the three archives into one shared object in a single LTO link, so
+# hot calls into libwapcaplet and libparserutils are inlined into libcss.
+# Only the public css_/lwc_/parserutils_ API is exported; everything else
+# becomes local, which lets the optimizer drop or specialize it.
+function makelinux_shared {
+  cat > lib/libcss.map <<END
+{
+  global: css_*; lwc_*; parserutils_*;
+  local: *;
+};
+END
+  rm -f lib/libcss.so*
+  gcc -shared $LINUX_CFLAGS -o lib/libcss.so.0 \
+      -Wl,-soname,libcss.so.0 -Wl,--version-script=lib/libcss.map \
+      -Wl,--whole-archive lib/libcss.a lib/libparserutils.a \
+      lib/libwapcaplet.a -Wl,--no-whole-archive -pthread || exit $?
+  ln -fs libcss.so.0 lib/libcss.so
+}
 
-echo '------------------- headers -------------------'
-mkdir -p include
+# pkg-config files for the installed tree. The top-level *.pc files are only
+# used to locate the dependencies while building libcss in-tree.
+function write_pkgconfig {
+  prefix="${PREFIX:-$(pwd)}"
+  mkdir -p lib/pkgconfig
+  for spec in \
+      "libparserutils|parserutils|Utility library for facilitating parser development|" \
+      "libwapcaplet|wapcaplet|String internalisation dictionary||-pthread" \
+      "libcss|css|CSS parser and selection engine|libparserutils libwapcaplet" ; do
+    IFS='|' read name lib desc requires libs <<< "$spec"
+    {
+      echo "prefix=$prefix"
+      echo 'exec_prefix=${prefix}'
+      echo 'libdir=${exec_prefix}/lib'
+      echo 'includedir=${prefix}/include'
+      echo
+      echo "Name: $name"
+      echo "Description: $desc"
+      echo "Version: 1.0"
+      [ -n "$requires" ] && echo "Requires.private: $requires"
+      echo "Libs: -L\${libdir} -l$lib"
+      [ -n "$libs" ] && echo "Libs.private: $libs"
+      echo 'Cflags: -I${includedir}'
+    } > lib/pkgconfig/$name.pc
+  done
+}
 
-echo cp -fR libparserutils/include/parserutils include/
-rm -rf include/parserutils
-cp -fR libparserutils/include/parserutils include/
+function build_linux {
+  echo '------------------- libwapcaplet -------------------'
+  ln -fs ../libwapcaplet.pc libwapcaplet/libwapcaplet.pc
+  makelinux_ifdirty libwapcaplet libwapcaplet.a
 
-echo cp -fR libwapcaplet/include/libwapcaplet include/
-rm -rf include/libwapcaplet
-cp -fR libwapcaplet/include/libwapcaplet include/
+  echo '------------------- libparserutils -------------------'
+  ln -fs ../libparserutils.pc libparserutils/libparserutils.pc
+  makelinux_ifdirty libparserutils libparserutils.a
 
-echo cp -fR libcss/include/libcss include/
-rm -rf include/libcss
-cp -fR libcss/include/libcss include/
+  echo '------------------- libcss -------------------'
+  if ! (isuptodate_linux libcss libcss.a) || [ "$deps_changed" = "1" ]; then
+    makelinux libcss libcss.a \
+        '-I../libparserutils/include -I../libwapcaplet/include -L..'
+    deps_changed=1
+  fi
+  if [ ! -f lib/libcss.so.0 ] || [ "$deps_changed" = "1" ]; then
+    makelinux_shared
+  fi
+  write_pkgconfig
+  ls -l lib/libcss.a lib/libparserutils.a lib/libwapcaplet.a lib/libcss.so.0
+}
 
-find include -name .svn -type d -exec rm -rf '{}' ';' 2>/dev/null
+# Remove Linux build products so the next build_linux recompiles everything
+# (make can not tell that LINUX_CFLAGS changed)
+function clean_linux {
+  rm -rf libwapcaplet/build-*linux* libparserutils/build-*linux* \
+         libcss/build-*linux*
+  rm -f lib/libwapcaplet.a lib/libparserutils.a lib/libcss.a lib/libcss.so*
+}
+
+# Build the shared object once per glibc-hwcaps level into
+# lib/glibc-hwcaps/<level>, where the dynamic loader (glibc 2.33 and later)
+# picks the best one the host supports when loading lib/libcss.so.0. The
+# baseline (plain x86-64) build is done last so that it is what remains in
+# lib. Older loaders ignore the subdirectories and use the baseline.
+function build_linux_multiversion {
+  base_cflags="$LINUX_CFLAGS"
+  rm -rf lib/glibc-hwcaps
+  for level in ${HWCAPS_LEVELS:-x86-64-v3}; do
+    echo "------------------- $level -------------------"
+    LINUX_CFLAGS="$base_cflags -march=$level"
+    clean_linux
+    build_linux
+    mkdir -p lib/glibc-hwcaps/$level
+    mv -f lib/libcss.so.0 lib/glibc-hwcaps/$level/libcss.so.0 || exit $?
+  done
+  echo '------------------- x86-64 -------------------'
+  LINUX_CFLAGS="$base_cflags -march=x86-64 -mtune=generic"
+  clean_linux
+  build_linux
+  LINUX_CFLAGS="$base_cflags"
+}
+
+function build_universal {
+  echo '------------------- libwapcaplet -------------------'
+  ln -fs ../libwapcaplet.pc libwapcaplet/libwapcaplet.pc
+  makeuniversal_ifdirty libwapcaplet libwapcaplet.a
+  lipo -info lib/libwapcaplet.a
+
+  echo '------------------- libparserutils -------------------'
+  ln -fs ../libparserutils.pc libparserutils/libparserutils.pc
+  makeuniversal_ifdirty libparserutils libparserutils.a
+  lipo -info lib/libparserutils.a
+
+  echo '------------------- libcss -------------------'
+  if ! (isuptodate libcss libcss.a) || [ "$deps_changed" = "1" ]; then
+    makeuniversal libcss libcss.a \
+        '-I../libparserutils/include -I../libwapcaplet/include -L..'
+  fi
+  lipo -info lib/libcss.a
+}
+
+function install_headers {
+  echo '------------------- headers -------------------'
+  mkdir -p include
+
+  echo cp -fR libparserutils/include/parserutils include/
+  rm -rf include/parserutils
+  cp -fR libparserutils/include/parserutils include/
+
+  echo cp -fR libwapcaplet/include/libwapcaplet include/
+  rm -rf include/libwapcaplet
+  cp -fR libwapcaplet/include/libwapcaplet include/
+
+  echo cp -fR libcss/include/libcss include/
+  rm -rf include/libcss
+  cp -fR libcss/include/libcss include/
+
+  # the revision compiled stylesheet files are tied to, see
+  # cocoa-framework/CSSStylesheet-compiled.h
+  echo "#define CSS_LIBCSS_REVISION $NETSURF_SVN_REV" > include/css-revision.h
+
+  find include -name .svn -type d -exec rm -rf '{}' ';' 2>/dev/null
+}
+
+# Build tools/$1.c against the static libraries in lib into tools/build/$1
+function buildtool {
+  mkdir -p tools/build
+  if [ "$BUILD_MODE" = "linux" ]; then
+    flags="$LINUX_CFLAGS"
+    libs="-Wl,-Bstatic -lcss -lparserutils -lwapcaplet -Wl,-Bdynamic"
+  else
+    flags="-O2 -g -DNDEBUG"
+    libs="-lcss -lparserutils -lwapcaplet"
+  fi
+  gcc -std=gnu99 $flags -W -Wall -Wno-deprecated -Iinclude -pthread \
+      -o tools/build/$1 tools/$1.c tools/synth.c tools/bench-util.c \
+      -x c cocoa-framework/CSSSelectHandlerBase.m \
+      cocoa-framework/css-lwc-lock.m cocoa-framework/css-lwc-caseless.m \
+      cocoa-framework/css-atoms.m -x none -Llib $libs || exit $?
+}
+
+# Build tools/$1.m together with the CSS.framework sources (OS X only)
+function buildtool_objc {
+  mkdir -p tools/build
+  ln -fsn ../../cocoa-framework tools/build/CSS
+  clang -x objective-c -std=gnu99 -O2 -g -DNDEBUG -fblocks \
+      -Iinclude -Itools/build -Icocoa-framework \
+      -include cocoa-framework/prefix.pch \
+      -o tools/build/$1 tools/$1.m cocoa-framework/*.m \
+      -x c tools/synth.c tools/bench-util.c -x none \
+      -framework Cocoa -Llib -lcss -lparserutils -lwapcaplet || exit $?
+}
+
+# Regenerate the framework's atom table (css-atoms.h, css-atoms.m) when
+# tools/atoms.txt has changed
+function generate_atoms {
+  if [ tools/atoms.txt -nt cocoa-framework/css-atoms.m ]; then
+    mkdir -p tools/build
+    gcc -std=gnu99 -O2 -W -Wall -o tools/build/gen-atoms tools/gen-atoms.c \
+        || exit $?
+    tools/build/gen-atoms tools/atoms.txt cocoa-framework || exit $?
+  fi
+}
+
+mkdir -p lib
+generate_atoms
+
+if [ "$PGO" = "1" ]; then
+  PGO_DIR="$(pwd)/pgo-data"
+  PGO_CORPUS=${PGO_CORPUS:-tools/corpus}
+  LINUX_CFLAGS_BASE="$LINUX_CFLAGS"
+  rm -rf "$PGO_DIR"
+
+  echo '------------------- PGO: instrumented build -------------------'
+  LINUX_CFLAGS="$LINUX_CFLAGS_BASE -fprofile-generate=$PGO_DIR"
+  clean_linux
+  build_linux
+  install_headers
+  buildtool train
+
+  echo '------------------- PGO: training -------------------'
+  tools/build/train -i ${PGO_ITERATIONS:-5} -n ${PGO_NODES:-20000} \
+      $(find "$PGO_CORPUS" -name '*.css' | sort) || exit $?
+
+  echo '------------------- PGO: optimized build -------------------'
+  LINUX_CFLAGS="$LINUX_CFLAGS_BASE -fprofile-use=$PGO_DIR"
+  LINUX_CFLAGS="$LINUX_CFLAGS -fprofile-partial-training -Wno-missing-profile"
+  clean_linux
+  build_linux
+elif [ "$BUILD_MODE" = "linux" ] && [ "$MULTIVERSION" = "1" ]; then
+  build_linux_multiversion
+elif [ "$BUILD_MODE" = "linux" ]; then
+  # stale variants would shadow the freshly built baseline
+  rm -rf lib/glibc-hwcaps
+  build_linux
+else
+  [ "$MULTIVERSION" = "1" ] && UNIVERSAL_ARCHS="$UNIVERSAL_ARCHS x86_64h"
+  build_universal
+fi
+
+install_headers
 
 echo '------------------- example1 -------------------'
 
 cd libcss/examples
-gcc -g -W -Wall -o example1 example1.c \
-  -lcss -lparserutils -lwapcaplet -L../../lib -I../../include -L../../lib \
-  || exit $?
+if [ "$BUILD_MODE" = "linux" ]; then
+  gcc $LINUX_CFLAGS -W -Wall -o example1 example1.c \
+    -I../../include -L../../lib -Wl,-Bstatic -lcss -lparserutils -lwapcaplet \
+    -Wl,-Bdynamic -pthread || exit $?
+else
+  gcc -g -W -Wall -o example1 example1.c \
+    -lcss -lparserutils -lwapcaplet -L../../lib -I../../include -L../../lib \
+    || exit $?
+fi
 ./example1
+cd ../..
+
+echo '------------------- stress-intern -------------------'
+buildtool stress-intern
+tools/build/stress-intern || exit $?
+
+if [ "$(uname)" = "Darwin" ]; then
+  echo '------------------- test-load-file -------------------'
+  buildtool_objc test-load-file
+  tools/build/test-load-file || exit $?
+fi
+
+if [ "$BENCH" = "1" ]; then
+  echo '------------------- bench -------------------'
+  BENCH_CORPUS=${BENCH_CORPUS:-tools/corpus}
+  bench_inputs=$(find "$BENCH_CORPUS" -name '*.css' | sort)
+  buildtool bench
+  tools/build/bench $BENCH_ARGS $bench_inputs > bench_output.txt || exit $?
+  buildtool bench-caseless
+  tools/build/bench-caseless $BENCH_ARGS >> bench_output.txt || exit $?
+  buildtool bench-intern-lwc
+  tools/build/bench-intern-lwc $BENCH_ARGS >> bench_output.txt || exit $?
+  if [ "$(uname)" = "Darwin" ]; then
+    buildtool_objc bench-style
+    tools/build/bench-style $BENCH_ARGS $bench_inputs >> bench_output.txt \
+        || exit $?
+    buildtool_objc bench-intern
+    tools/build/bench-intern $BENCH_ARGS >> bench_output.txt || exit $?
+  fi
+  cat bench_output.txt
+  if [ -n "$BENCH_BASELINE" ]; then
+    echo '------------------- bench-compare -------------------'
+    gcc -std=gnu99 -O2 -W -Wall -o tools/build/bench-compare \
+        tools/bench-compare.c || exit $?
+    tools/build/bench-compare $BENCH_COMPARE_ARGS "$BENCH_BASELINE" \
+        bench_output.txt || exit $?
+  fi
+fi
 
 #echo '------------------- CSS.framework -------------------'
 #
-#cd ../../cocoa-framework
+#cd cocoa-framework
 #xcodebuild -project CSS.xcodeproj \
 #           -target CSS \
 #           -parallelizeTargets \
@@ -1,5 +1,6 @@
 
 #import <Cocoa/Cocoa.h>
+#import <dispatch/dispatch.h>
 
 // Headers
 // If not found, add "CSS.framework/Headers" to HEADER_SEARCH_PATHS
@@ -9,6 +10,8 @@
 
 // Main classes
 #import <CSS/CSSStylesheet.h>
+#import <CSS/CSSStylesheetCache.h>
+#import <CSS/CSSStylesheet-compiled.h>
 #import <CSS/CSSContext.h>
 #import <CSS/CSSStyle.h>
 
@@ -17,4 +20,43 @@
 #import <CSS/NSColor-css.h>
 #import <CSS/NSString-wapcaplet.h>
 #import <CSS/css-cf-realloc.h>
+#import <CSS/css-arena.h>
+#import <CSS/css-style-pool.h>
+#import <CSS/css-alloc-stats.h>
+#import <CSS/css-lwc-lock.h>
+#import <CSS/css-lwc-caseless.h>
+#import <CSS/css-atoms.h>
+#import <CSS/css-lwc-intern.h>
+#import <CSS/css-file-map.h>
 #import <CSS/CSSSelectHandlerBase.h>
+
+@interface CSS : NSObject {
+}
+
+/**
+ * Allocation counters per owner (see css-alloc-stats.h), keyed by owner
+ * ("stylesheet", "selection", "computed-style", "strings"). Each value is a
+ * dictionary with "liveBytes", "peakBytes", "allocCalls", "reallocCalls",
+ * "freeCalls" and "histogram", an array of allocation counts for requested
+ * sizes of <= 16, <= 32, ... <= 32768 bytes and larger.
+ */
++ (NSDictionary*)allocationStatistics;
+
+/**
+ * State of string interning, for monitoring: "table" (libwapcaplet's intern
+ * table, see lwc_stats: "strings", "bytes", "buckets", "usedBuckets",
+ * "maxChain", "chains" (an array of bucket counts by chain length, the last
+ * one counting all longer chains), "rehashes" and "migrating"), "cache" (the
+ * cache behind -[NSString LWCString], see css_lwc_cache_stats, plus
+ * "loadFactor") and "atoms" (number of atoms).
+ */
++ (NSDictionary*)internStatistics;
+
+/**
+ * Counters of the parsed stylesheet cache (see CSSStylesheetCache.h):
+ * "hits", "misses", "insertions", "evictions", "entries", "bytes" and
+ * "limit".
+ */
++ (NSDictionary*)stylesheetCacheStatistics;
+
+@end
@@ -1,9 +1,90 @@
 #import "CSS.h"
 #import "internal.h"
 
-@interface CSS : NSObject {
-}
-@end
 @implementation CSS
 
+
++ (NSDictionary*)allocationStatistics {
+  NSMutableDictionary *result =
+      [NSMutableDictionary dictionaryWithCapacity:CSS_ALLOC_NUM_TAGS];
+  int tag, i;
+  for (tag = 0; tag < CSS_ALLOC_NUM_TAGS; tag++) {
+    css_alloc_stats stats;
+    css_alloc_get_stats((css_alloc_tag)tag, &stats);
+    NSMutableArray *histogram =
+        [NSMutableArray arrayWithCapacity:CSS_ALLOC_HISTOGRAM_SIZE];
+    for (i = 0; i < CSS_ALLOC_HISTOGRAM_SIZE; i++) {
+      [histogram addObject:
+          [NSNumber numberWithUnsignedLongLong:stats.histogram[i]]];
+    }
+    [result setObject:[NSDictionary dictionaryWithObjectsAndKeys:
+        [NSNumber numberWithUnsignedLongLong:stats.liveBytes], @"liveBytes",
+        [NSNumber numberWithUnsignedLongLong:stats.peakBytes], @"peakBytes",
+        [NSNumber numberWithUnsignedLongLong:stats.allocCalls], @"allocCalls",
+        [NSNumber numberWithUnsignedLongLong:stats.reallocCalls],
+            @"reallocCalls",
+        [NSNumber numberWithUnsignedLongLong:stats.freeCalls], @"freeCalls",
+        histogram, @"histogram",
+        nil]
+               forKey:[NSString stringWithUTF8String:
+                   css_alloc_tag_name((css_alloc_tag)tag)]];
+  }
+  return result;
+}
+
+
++ (NSDictionary*)internStatistics {
+  css_lwc_cache_stats cache;
+  lwc_stats table;
+  css_lwc_cache_get_stats(&cache);
+  lwc_get_stats(&table);
+  double loadFactor = cache.slots ? (double)cache.used / cache.slots : 0.0;
+  NSMutableArray *chains = [NSMutableArray arrayWithCapacity:LWC_STATS_CHAINS];
+  int i;
+  for (i = 0; i < LWC_STATS_CHAINS; i++)
+    [chains addObject:[NSNumber numberWithUnsignedLong:table.chains[i]]];
+  return [NSDictionary dictionaryWithObjectsAndKeys:
+      [NSDictionary dictionaryWithObjectsAndKeys:
+          [NSNumber numberWithUnsignedLong:table.strings], @"strings",
+          [NSNumber numberWithUnsignedLong:table.bytes], @"bytes",
+          [NSNumber numberWithUnsignedLong:table.buckets], @"buckets",
+          [NSNumber numberWithUnsignedLong:table.used_buckets],
+          @"usedBuckets",
+          [NSNumber numberWithUnsignedLong:table.max_chain], @"maxChain",
+          chains, @"chains",
+          [NSNumber numberWithUnsignedLongLong:table.rehashes], @"rehashes",
+          [NSNumber numberWithUnsignedLong:table.migrating], @"migrating",
+          nil], @"table",
+      [NSDictionary dictionaryWithObjectsAndKeys:
+          [NSNumber numberWithUnsignedLongLong:cache.lookups], @"lookups",
+          [NSNumber numberWithUnsignedLongLong:cache.hits], @"hits",
+          [NSNumber numberWithUnsignedLongLong:cache.misses], @"misses",
+          [NSNumber numberWithUnsignedLongLong:cache.evictions], @"evictions",
+          [NSNumber numberWithUnsignedLongLong:cache.resizes], @"resizes",
+          [NSNumber numberWithUnsignedLongLong:cache.slots], @"slots",
+          [NSNumber numberWithUnsignedLongLong:cache.used], @"used",
+          [NSNumber numberWithUnsignedLongLong:cache.migrating], @"migrating",
+          [NSNumber numberWithUnsignedLongLong:cache.bytes], @"bytes",
+          [NSNumber numberWithDouble:loadFactor], @"loadFactor",
+          nil], @"cache",
+      [NSNumber numberWithInt:CSS_ATOM_COUNT], @"atoms",
+      nil];
+}
+
+
++ (NSDictionary*)stylesheetCacheStatistics {
+  css_sheet_cache_stats stats;
+  [CSSStylesheetCache getStatistics:&stats];
+  return [NSDictionary dictionaryWithObjectsAndKeys:
+      [NSNumber numberWithUnsignedLongLong:stats.hits], @"hits",
+      [NSNumber numberWithUnsignedLongLong:stats.misses], @"misses",
+      [NSNumber numberWithUnsignedLongLong:stats.insertions], @"insertions",
+      [NSNumber numberWithUnsignedLongLong:stats.evictions], @"evictions",
+      [NSNumber numberWithUnsignedLong:stats.entries], @"entries",
+      [NSNumber numberWithUnsignedLong:stats.bytes], @"bytes",
+      [NSNumber numberWithUnsignedLong:stats.limit], @"limit",
+      nil];
+}
+
+
 @end
@@ -2,9 +2,25 @@
 
 @interface CSSContext : NSObject <NSFastEnumeration> {
   css_select_ctx *ctx_;
+  struct css_alloc_tracker *allocTracker_;
+  // the sheets of ctx_, in the same order. Several CSSStylesheets may share
+  // one css_stylesheet (see CSSStylesheetCache.h), so they can not be told
+  // apart by their css_stylesheet.
+  NSMutableArray *stylesheets_;
 }
 
 @property(readonly, nonatomic) css_select_ctx *ctx;
+@property(readonly, nonatomic) struct css_alloc_tracker *allocTracker;
+
+/**
+ * Maximum number of bytes libcss may allocate for this context, or 0 for no
+ * limit (the default). Selection which would exceed the limit fails with a
+ * CSS_NOMEM error (see CSSStyle) and leaves the context usable.
+ */
+@property(nonatomic) size_t memoryLimit;
+
+/// Number of bytes currently allocated by libcss for this context
+@property(readonly, nonatomic) size_t memoryUsage;
 
 - (id)init;
 - (id)initWithStylesheet:(CSSStylesheet*)stylesheet;
@@ -4,23 +4,33 @@
 #import "internal.h"
 
 
-inline static CSSStylesheet *_getCSSStylesheet(const css_stylesheet *sheet) {
-  CSSStylesheet *stylesheet = nil;
-  CSSCheck(css_stylesheet_get_resolve_pw((css_stylesheet *)sheet,
-                                         (void **)&stylesheet));
-  return stylesheet;
-}
-
-
 @implementation CSSContext
 
-@synthesize ctx = ctx_;
+@synthesize ctx = ctx_,
+            allocTracker = allocTracker_;
 
 
 - (id)init {
   if (!(self = [super init])) return nil;
 
-  NSException *e = CSSCheck2(css_select_ctx_create(&css_cf_realloc, 0, &ctx_));
+  stylesheets_ = [[NSMutableArray alloc] init];
+  allocTracker_ = CFAllocatorAllocate(kCFAllocatorDefault,
+                                      sizeof(css_alloc_tracker), 0);
+  if (!allocTracker_) {
+    [self release];
+    return nil;
+  }
+  memset(allocTracker_, 0, sizeof(css_alloc_tracker));
+  allocTracker_->alloc = &css_zone_realloc;
+  allocTracker_->size = &css_zone_block_size;
+  allocTracker_->owns = &css_zone_owns;
+  allocTracker_->tag = CSS_ALLOC_SELECTION;
+
+  // Note: arrays returned by node_classes handlers are freed by libcss with
+  // this allocator and should be allocated with css_cf_realloc. They are not
+  // counted against the context's budget.
+  NSException *e = CSSCheck2(css_select_ctx_create(&css_tracking_realloc,
+      allocTracker_, &ctx_));
 	if (e) {
     [self release];
     [e raise];
@@ -39,14 +49,29 @@ inline static CSSStylesheet *_getCSSStylesheet(const css_stylesheet *sheet) {
 
 
 - (void)dealloc {
-  for (CSSStylesheet *stylesheet in self) {
-    [stylesheet release];
-  }
-  css_select_ctx_destroy(ctx_);
+  if (ctx_) css_select_ctx_destroy(ctx_);
+  // (after ctx_, which references their sheets)
+  [stylesheets_ release];
+  if (allocTracker_) CFAllocatorDeallocate(kCFAllocatorDefault, allocTracker_);
   [super dealloc];
 }
 
 
+- (size_t)memoryLimit {
+  return allocTracker_->limit;
+}
+
+
+- (void)setMemoryLimit:(size_t)limit {
+  allocTracker_->limit = limit;
+}
+
+
+- (size_t)memoryUsage {
+  return (size_t)allocTracker_->used;
+}
+
+
 
 #pragma mark -
 #pragma mark Adding, retrieving and removing stylesheets
@@ -55,56 +80,44 @@ inline static CSSStylesheet *_getCSSStylesheet(const css_stylesheet *sheet) {
 - (void)addStylesheet:(CSSStylesheet*)stylesheet {
   if (CSSCheck(css_select_ctx_append_sheet(ctx_, stylesheet.sheet,
                                            CSS_ORIGIN_AUTHOR, CSS_MEDIA_ALL))) {
-    [stylesheet retain];
+    [stylesheets_ addObject:stylesheet];
   }
 }
 
 
 - (void)insertStylesheet:(CSSStylesheet*)stylesheet atIndex:(NSUInteger)index {
-  css_stylesheet *oldSheet = NULL;
-  css_select_ctx_get_sheet(ctx_, (uint32_t)index,
-                           (const css_stylesheet **)&oldSheet);
-  if (CSSCheck(css_select_ctx_insert_sheet(ctx_, stylesheet.sheet, index,
-                                           CSS_ORIGIN_AUTHOR, CSS_MEDIA_ALL))) {
-    [stylesheet retain];
-    if (oldSheet) {
-      [_getCSSStylesheet(oldSheet) release];
-    }
-  } 
+  if (CSSCheck(css_select_ctx_insert_sheet(ctx_, stylesheet.sheet,
+                                           (uint32_t)index, CSS_ORIGIN_AUTHOR,
+                                           CSS_MEDIA_ALL))) {
+    [stylesheets_ insertObject:stylesheet atIndex:index];
+  }
 }
 
 
 - (CSSStylesheet*)stylesheetAtIndex:(NSUInteger)index {
-  css_stylesheet *sheet = NULL;
-  if (CSSCheck(css_select_ctx_get_sheet(ctx_, (uint32_t)index,
-                                        (const css_stylesheet **)&sheet))) {
-    return _getCSSStylesheet(sheet);
-  }
-  return nil;
+  return index < stylesheets_.count ? [stylesheets_ objectAtIndex:index] : nil;
 }
 
 
 - (void)removeStylesheet:(CSSStylesheet*)stylesheet {
-  if (CSSCheck(css_select_ctx_remove_sheet(ctx_, stylesheet.sheet))) {
-    [stylesheet release];
-  }
+  NSUInteger index = [stylesheets_ indexOfObjectIdenticalTo:stylesheet];
+  if (index != NSNotFound) [self removeStylesheetAtIndex:index];
 }
 
 
 - (void)removeStylesheetAtIndex:(NSUInteger)index {
-  const css_stylesheet *sheet = NULL;
-  if (CSSCheck(css_select_ctx_get_sheet(ctx_, index, &sheet))) {
-    if (CSSCheck(css_select_ctx_remove_sheet(ctx_, sheet))) {
-      [_getCSSStylesheet(sheet) release];
-    }
+  if (index >= stylesheets_.count) return;
+  // libcss removes the first occurrence of the css_stylesheet, which may be
+  // another CSSStylesheet sharing it; those are interchangeable for libcss
+  CSSStylesheet *stylesheet = [stylesheets_ objectAtIndex:index];
+  if (CSSCheck(css_select_ctx_remove_sheet(ctx_, stylesheet.sheet))) {
+    [stylesheets_ removeObjectAtIndex:index];
   }
 }
 
 
 - (NSUInteger)count {
-  uint32_t count = 0;
-  CSSCheck(css_select_ctx_count_sheets(ctx_, &count));
-  return (NSUInteger)count;
+  return stylesheets_.count;
 }
 
 
@@ -113,19 +126,9 @@ inline static CSSStylesheet *_getCSSStylesheet(const css_stylesheet *sheet) {
 - (NSUInteger)countByEnumeratingWithState:(NSFastEnumerationState *)state
                                   objects:(id *)stackbuf
                                     count:(NSUInteger)fetchCount {
-  uint32_t totalCount = 0;
-  CSSCheck(css_select_ctx_count_sheets(ctx_, &totalCount));
-  
-  NSUInteger fetchIndex = 0;
-  while (state->state+fetchIndex < totalCount && fetchIndex < fetchCount) {
-    stackbuf[fetchIndex++] = [self stylesheetAtIndex:state->state + fetchIndex];
-  }
-  
-  state->state += fetchIndex;
-  state->itemsPtr = stackbuf;
-  state->mutationsPtr = (unsigned long *)self;  // TODO
-  
-  return fetchIndex;
+  return [stylesheets_ countByEnumeratingWithState:state
+                                           objects:stackbuf
+                                             count:fetchCount];
 }
 
 
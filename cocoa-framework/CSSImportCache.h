@@ -0,0 +1,86 @@
+@class CSSStylesheet;
+
+/**
+ * Limits on following @imports, shared by a root stylesheet and every sheet
+ * loaded for its imports, and the number of @import rules followed so far.
+ */
+@interface CSSImportBudget : NSObject {
+ @public
+  NSUInteger maxDepth;
+  NSUInteger maxCount;
+  volatile int32_t count;
+}
+@end
+
+/**
+ * A stylesheet loaded for @import rules, shared by every sheet importing the
+ * same absolute URL with the same media. Imports are kept in a process-wide
+ * cache for as long as some importing sheet uses them, so a common base
+ * sheet is fetched and parsed once however many themes import it, and
+ * sheets importing a URL which is still loading wait for that load instead
+ * of starting another one.
+ *
+ * A failed import is dropped from the cache as soon as it has failed, so the
+ * next sheet importing its URL tries again.
+ *
+ * While an import is loading, it records which imports its sheet waits for,
+ * so that an import which would end up waiting for itself (a.css importing
+ * b.css importing a.css, each first imported from somewhere else) is
+ * refused instead of never finishing.
+ */
+@interface CSSImport : NSObject {
+  NSString *key_;
+  CSSStylesheet *sheet_;
+  uint64_t media_;
+  NSUInteger users_;
+  BOOL loaded_;
+  NSError *error_;
+  NSMutableArray *waiters_;
+  NSMutableArray *dependencies_;  // CSSImports our sheet waits for
+}
+
+@property(readonly, nonatomic) CSSStylesheet *sheet;
+@property(readonly, nonatomic) uint64_t media;
+
+/**
+ * Returns the import for |url| and |media|, starting to load it if it is not
+ * already cached. A new sheet takes the memory limit and import budget of
+ * |importer|. Must be balanced with a call to -relinquish.
+ */
++ (CSSImport*)acquireImportWithURL:(NSURL*)url
+                             media:(uint64_t)media
+                          importer:(CSSStylesheet*)importer;
+
+/**
+ * Returns an import of |sheet|, which has already been loaded by other
+ * means, outside of the cache. Must be balanced with a call to -relinquish.
+ */
++ (CSSImport*)importWithLoadedSheet:(CSSStylesheet*)sheet
+                              media:(uint64_t)media;
+
+/**
+ * Record that the sheet of the receiver waits for |import| to load. Returns
+ * NO, recording nothing, if |import| (indirectly) waits for the receiver.
+ */
+- (BOOL)addDependency:(CSSImport*)import;
+
+/// Stop using the import, dropping it from the cache if it was the last user
+- (void)relinquish;
+
+/// Invoke |callback| once the sheet has loaded (or right away if it has)
+- (void)whenLoaded:(void(^)(NSError *error))callback;
+
+/// Number of imports currently cached
++ (NSUInteger)cachedImportCount;
+
+@end
+
+
+@interface CSSStylesheet (CSSImport)
+/// Absolute URLs of the sheets which led to loading this one, and its own
+- (NSArray*)importChain;
+- (CSSImportBudget*)importBudget;
+- (void)setImport:(CSSImport*)import
+      importChain:(NSArray*)chain
+           budget:(CSSImportBudget*)budget;
+@end
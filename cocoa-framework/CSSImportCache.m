@@ -0,0 +1,190 @@
+#import "CSSImportCache.h"
+#import "CSSStylesheet.h"
+#import "NSError-css.h"
+
+#import "internal.h"
+
+#import <pthread.h>
+
+// imports by "<media> <absolute URL>", guarded by gCacheLock_
+static NSMutableDictionary *gCache_ = nil;
+static pthread_mutex_t gCacheLock_ = PTHREAD_MUTEX_INITIALIZER;
+
+
+@implementation CSSImportBudget
+@end
+
+
+@interface CSSImport ()
+- (id)initWithKey:(NSString*)key sheet:(CSSStylesheet*)sheet;
+- (void)_loadedWithError:(NSError*)error;
+@end
+
+
+@implementation CSSImport
+
+@synthesize sheet = sheet_,
+            media = media_;
+
+
++ (CSSImport*)acquireImportWithURL:(NSURL*)url
+                             media:(uint64_t)media
+                          importer:(CSSStylesheet*)importer {
+  NSString *key = [NSString stringWithFormat:@"%llx %@",
+                   (unsigned long long)media, [url absoluteString]];
+  BOOL created = NO;
+  pthread_mutex_lock(&gCacheLock_);
+  if (!gCache_) gCache_ = [[NSMutableDictionary alloc] init];
+  CSSImport *import = [gCache_ objectForKey:key];
+  if (!import) {
+    CSSStylesheet *sheet = [[CSSStylesheet alloc] initWithURL:url];
+    if (sheet) {
+      sheet.memoryLimit = importer.memoryLimit;
+      import = [[CSSImport alloc] initWithKey:key sheet:sheet];
+      import->media_ = media;
+      [sheet setImport:import
+           importChain:[importer.importChain
+                        arrayByAddingObject:[url absoluteString]]
+                budget:importer.importBudget];
+      [gCache_ setObject:import forKey:key];
+      [import release];
+      [sheet release];
+      created = YES;
+    }
+  }
+  if (import) {
+    import->users_++;
+    [import retain];
+  }
+  pthread_mutex_unlock(&gCacheLock_);
+
+  // start loading outside of the lock, as the load may complete right away
+  if (created) {
+    BOOL started = [import.sheet loadFromRepresentedURLWithCallback:
+        ^(NSError *error) {
+      [import _loadedWithError:error];
+    }];
+    if (!started)
+      [import _loadedWithError:[NSError libcssErrorFromStatus:CSS_INVALID]];
+  }
+  return [import autorelease];
+}
+
+
++ (CSSImport*)importWithLoadedSheet:(CSSStylesheet*)sheet
+                              media:(uint64_t)media {
+  CSSImport *import = [[CSSImport alloc] initWithKey:nil sheet:sheet];
+  import->media_ = media;
+  import->users_ = 1;
+  import->loaded_ = YES;
+  return [import autorelease];
+}
+
+
++ (NSUInteger)cachedImportCount {
+  pthread_mutex_lock(&gCacheLock_);
+  NSUInteger count = gCache_.count;
+  pthread_mutex_unlock(&gCacheLock_);
+  return count;
+}
+
+
+- (id)initWithKey:(NSString*)key sheet:(CSSStylesheet*)sheet {
+  if (!(self = [super init])) return nil;
+  key_ = [key copy];
+  sheet_ = [sheet retain];
+  waiters_ = [[NSMutableArray alloc] init];
+  dependencies_ = [[NSMutableArray alloc] init];
+  return self;
+}
+
+
+- (void)dealloc {
+  [key_ release];
+  [sheet_ release];
+  [error_ release];
+  [waiters_ release];
+  [dependencies_ release];
+  [super dealloc];
+}
+
+
+// Remove from the cache, must be called with gCacheLock_ held
+- (void)_uncache {
+  if (key_ && [gCache_ objectForKey:key_] == self)
+    [gCache_ removeObjectForKey:key_];
+}
+
+
+- (void)relinquish {
+  pthread_mutex_lock(&gCacheLock_);
+  assert(users_ > 0);
+  if (--users_ == 0) [self _uncache];
+  pthread_mutex_unlock(&gCacheLock_);
+}
+
+
+// Whether the receiver is, or waits for, |import|. Must be called with
+// gCacheLock_ held.
+- (BOOL)_waitsFor:(CSSImport*)import {
+  if (self == import) return YES;
+  for (CSSImport *dependency in dependencies_) {
+    if ([dependency _waitsFor:import]) return YES;
+  }
+  return NO;
+}
+
+
+- (BOOL)addDependency:(CSSImport*)import {
+  BOOL added = YES;
+  pthread_mutex_lock(&gCacheLock_);
+  // loaded imports wait for nothing, and keep no dependencies
+  if (!import->loaded_) {
+    if ([import _waitsFor:self])
+      added = NO;
+    else
+      [dependencies_ addObject:import];
+  }
+  pthread_mutex_unlock(&gCacheLock_);
+  return added;
+}
+
+
+- (void)_loadedWithError:(NSError*)error {
+  pthread_mutex_lock(&gCacheLock_);
+  loaded_ = YES;
+  error_ = [error retain];
+  [dependencies_ removeAllObjects];
+  if (error) [self _uncache];
+  NSArray *waiters = waiters_;
+  waiters_ = nil;
+  pthread_mutex_unlock(&gCacheLock_);
+
+  for (void(^callback)(NSError*) in waiters)
+    callback(error);
+  [waiters release];
+}
+
+
+- (void)whenLoaded:(void(^)(NSError*))callback {
+  pthread_mutex_lock(&gCacheLock_);
+  if (!loaded_) {
+    callback = [callback copy];
+    [waiters_ addObject:callback];
+    [callback release];
+    pthread_mutex_unlock(&gCacheLock_);
+    return;
+  }
+  pthread_mutex_unlock(&gCacheLock_);
+  callback(error_);
+}
+
+
+- (NSString*)description {
+  return [NSString stringWithFormat:@"<%@@%p %@ users=%lu%@>",
+      NSStringFromClass([self class]), self, key_, (unsigned long)users_,
+      loaded_ ? @"" : @" loading"];
+}
+
+
+@end
@@ -1,7 +1,8 @@
+#import <libcss/libcss.h>
+#import <libcss/fpmath.h>
 #import "CSSSelectHandlerBase.h"
-#import "CSS.h"
+#import "css-atoms.h"
 #import <assert.h>
-#import <libcss/fpmath.h>
 #import <string.h>
 
 /* This macro is used to silence compiler warnings about unused function
@@ -11,7 +12,7 @@
 
 static css_error node_name(void *pw, void *n, lwc_string **name) {
 	UNUSED(pw);
-	lwc_intern_string("", 0, name); // |name| must be a valid lwc_string
+	*name = lwc_string_ref(CSS_ATOM(EMPTY)); // must be a valid lwc_string
 	return CSS_OK;
 }
 
@@ -15,6 +15,25 @@
                       inlineStyle:(CSSStylesheet*)inlineStyle
                      usingHandler:(css_select_handler*)handler;
 
+/**
+ * Like the above, but running out of memory (e.g. exceeding the memory
+ * limit of |context|) does not raise; nil is returned and |outError| is set.
+ */
++ (CSSStyle*)selectStyleForObject:(void*)object
+                        inContext:(CSSContext*)context
+                    pseudoElement:(int)pseudoElement
+                            media:(css_media_type)mediaTypes
+                      inlineStyle:(CSSStylesheet*)inlineStyle
+                     usingHandler:(css_select_handler*)handler
+                            error:(NSError**)outError;
+
+/**
+ * Counters of the pool computed styles are allocated from (see
+ * css-style-pool.h): "allocations", "reuses", "releases", "oversized",
+ * "cached" and "cachedBytes".
+ */
++ (NSDictionary*)poolStatistics;
+
 /**
  * Merge this style (parent) with another style (child). |child| has
  * precedence. A new autoreleased CSSStyle object is returned.
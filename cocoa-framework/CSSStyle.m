@@ -26,6 +26,29 @@ static CGFloat _UIScaleFactor() {
                             media:(css_media_type)mediaTypes
                       inlineStyle:(CSSStylesheet*)inlineStyle
                      usingHandler:(css_select_handler*)handler {
+  NSError *error = nil;
+  CSSStyle *style = [self selectStyleForObject:object
+                                     inContext:context
+                                 pseudoElement:pseudoElement
+                                         media:mediaTypes
+                                   inlineStyle:inlineStyle
+                                  usingHandler:handler
+                                         error:&error];
+  if (!style && error) {
+    THROW_EXC(NSMallocException, @"CSS.framework: %@",
+              [error localizedDescription]);
+  }
+  return style;
+}
+
+
++ (CSSStyle*)selectStyleForObject:(void*)object
+                        inContext:(CSSContext*)context
+                    pseudoElement:(int)pseudoElement
+                            media:(css_media_type)mediaTypes
+                      inlineStyle:(CSSStylesheet*)inlineStyle
+                     usingHandler:(css_select_handler*)handler
+                            error:(NSError**)outError {
   CSSStyle *style = [[[self alloc] init] autorelease];
   if (!style) return nil;
   /**
@@ -50,10 +73,18 @@ static CGFloat _UIScaleFactor() {
    * the client to store the partially computed style and efficiently
    * update the fully computed style for a node when layout changes.
    */
-  NSException *e =
-      CSSCheck2(css_select_style(context.ctx, object, pseudoElement, mediaTypes,
+  int32_t limitHits = context.allocTracker->limitHits;
+  css_error status =
+      css_select_style(context.ctx, object, pseudoElement, mediaTypes,
           (inlineStyle ? inlineStyle.sheet : NULL), style->style_, handler,
-          style));
+          style);
+  if (status == CSS_NOMEM) {
+    if (outError)
+      *outError = CSSErrorFromStatus(status, context.allocTracker,
+                                     limitHits);
+    return nil;
+  }
+  NSException *e = CSSCheck2(status);
   if (e) {
     style = nil;
     [e raise];
@@ -62,10 +93,25 @@ static CGFloat _UIScaleFactor() {
 }
 
 
++ (NSDictionary*)poolStatistics {
+  css_style_pool_stats stats;
+  css_style_pool_get_stats(&stats);
+  return [NSDictionary dictionaryWithObjectsAndKeys:
+      [NSNumber numberWithUnsignedLongLong:stats.allocations], @"allocations",
+      [NSNumber numberWithUnsignedLongLong:stats.reuses], @"reuses",
+      [NSNumber numberWithUnsignedLongLong:stats.releases], @"releases",
+      [NSNumber numberWithUnsignedLongLong:stats.oversized], @"oversized",
+      [NSNumber numberWithUnsignedLongLong:stats.cached], @"cached",
+      [NSNumber numberWithUnsignedLongLong:stats.cachedBytes], @"cachedBytes",
+      nil];
+}
+
+
 - (id)init {
   if (!(self = [super init])) return nil;
   NSException *e =
-      CSSCheck2(css_computed_style_create(&css_cf_realloc, 0, &style_));
+      CSSCheck2(css_computed_style_create(&css_tracking_realloc,
+          &css_alloc_tracker_computed_style, &style_));
 	if (e) {
     style_ = NULL;
     [self release];
@@ -77,15 +123,16 @@ static CGFloat _UIScaleFactor() {
 
 
 - (void)dealloc {
-  css_computed_style_destroy(style_);
+  if (style_) css_computed_style_destroy(style_);
   [super dealloc];
 }
 
 
 - (CSSStyle*)mergeWith:(CSSStyle*)child {
   CSSStyle *mergedStyle = [[isa alloc] init];
-  NSException *e = CSSCheck2(css_computed_style_compose(self.style, child.style,
-		CSSSelectHandlerBase.compute_font_size, self, mergedStyle.style));
+  css_error status = css_computed_style_compose(self.style, child.style,
+      CSSSelectHandlerBase.compute_font_size, self, mergedStyle.style);
+  NSException *e = CSSCheck2(status);
   if (e) {
     [mergedStyle release];
     mergedStyle = nil;
@@ -0,0 +1,37 @@
+/**
+ * Compiled stylesheet files: a loaded sheet together with every sheet it
+ * @imports, written out so that other processes can load the whole tree
+ * from one memory-mapped file, without fetching or parsing any of it.
+ *
+ * A file starts with a header of the magic bytes "CSSC", the format
+ * version, the libcss revision, the version of libcss's serialised sheet
+ * format and the number of sheets, followed by one record per sheet in
+ * depth-first document order (the index of the importing sheet, its media,
+ * and the offset and length of its URL and data). All offsets are relative
+ * to the start of the file and all integers of the header and records are
+ * little-endian, so the file can be mapped anywhere.
+ *
+ * The data of a sheet is its parsed form (rules, selectors, bytecode and the
+ * strings they use) as written by css_stylesheet_serialise, which
+ * patches/libcss/stylesheet_serialise.patch adds to libcss. Loading rebuilds
+ * the sheet from it with css_stylesheet_load_serialised instead of parsing.
+ * That format is only understood by the same libcss on a machine of the same
+ * byte order, so files written by another format version, libcss revision
+ * or serialised format version (CSS_STYLESHEET_SERIALISED_VERSION) are
+ * rejected, and files moved to a machine of the other byte order fail to
+ * load.
+ */
+#define kCSSCompiledFormatVersion 2
+
+@interface CSSStylesheet (compiled)
+
+/**
+ * Write the receiver and its @imports to |path|. All of the sheets must have
+ * been loaded completely.
+ */
+- (BOOL)writeCompiledToFile:(NSString*)path error:(NSError**)error;
+
+/// Load a sheet and its @imports from a file written by -writeCompiledToFile:
+- (id)initWithCompiledFile:(NSString*)path error:(NSError**)error;
+
+@end
@@ -0,0 +1,313 @@
+#import "CSSStylesheet.h"
+#import "CSSStylesheet-compiled.h"
+#import "CSSImportCache.h"
+#import "NSError-css.h"
+#import "NSString-wapcaplet.h"
+#import "css-file-map.h"
+
+#import "internal.h"
+
+#import <libkern/OSByteOrder.h>
+
+// NETSURF_SVN_REV, written by build.sh along with the libcss headers
+#import <css-revision.h>
+#ifndef CSS_LIBCSS_REVISION
+#error "CSS_LIBCSS_REVISION is not set; install the headers with build.sh"
+#endif
+#define kCSSLibcssRevision CSS_LIBCSS_REVISION
+
+#define kNoParent UINT32_MAX
+
+typedef struct {
+  char magic[4];  // "CSSC"
+  uint32_t version;
+  uint32_t libcssRevision;
+  uint32_t serialisedVersion;  // CSS_STYLESHEET_SERIALISED_VERSION
+  uint32_t sheetCount;
+  uint32_t reserved;  // 0
+  uint64_t fileSize;
+} css_compiled_header;
+
+typedef struct {
+  uint32_t parent;  // index of the importing sheet, kNoParent for the root
+  uint32_t urlLength;
+  uint64_t urlOffset;
+  uint64_t media;
+  uint64_t dataOffset;
+  uint64_t dataLength;
+} css_compiled_sheet;
+
+
+static inline const css_compiled_sheet *_record(const css_file_map *map,
+                                                uint32_t index) {
+  return (const css_compiled_sheet *)((const char *)map->bytes +
+      sizeof(css_compiled_header)) + index;
+}
+
+
+static inline BOOL _inFile(const css_file_map *map, uint64_t offset,
+                           uint64_t length) {
+  return offset <= map->length && length <= map->length - offset;
+}
+
+
+// Reason why |map| can not be loaded, or nil if it can
+static NSString *_validate(const css_file_map *map) {
+  const css_compiled_header *header = map->bytes;
+  if (map->length < sizeof(css_compiled_header) ||
+      memcmp(header->magic, "CSSC", 4) != 0)
+    return @"not a compiled stylesheet";
+  uint32_t version = OSSwapLittleToHostInt32(header->version);
+  uint32_t revision = OSSwapLittleToHostInt32(header->libcssRevision);
+  uint32_t serialised = OSSwapLittleToHostInt32(header->serialisedVersion);
+  if (version != kCSSCompiledFormatVersion || revision != kCSSLibcssRevision ||
+      serialised != CSS_STYLESHEET_SERIALISED_VERSION) {
+    return [NSString stringWithFormat:
+        @"written in format %u for libcss r%u, serialised format %u "
+        @"(expected format %u, r%u, serialised format %u)",
+        version, revision, serialised, kCSSCompiledFormatVersion,
+        kCSSLibcssRevision, CSS_STYLESHEET_SERIALISED_VERSION];
+  }
+  if (OSSwapLittleToHostInt64(header->fileSize) != map->length)
+    return @"truncated";
+  uint32_t count = OSSwapLittleToHostInt32(header->sheetCount);
+  if (count == 0 || count > (map->length - sizeof(css_compiled_header)) /
+                            sizeof(css_compiled_sheet))
+    return @"corrupt sheet table";
+  uint32_t i;
+  for (i = 0; i < count; i++) {
+    const css_compiled_sheet *record = _record(map, i);
+    uint32_t parent = OSSwapLittleToHostInt32(record->parent);
+    if ((i == 0) != (parent == kNoParent) || (i > 0 && parent >= i) ||
+        !_inFile(map, OSSwapLittleToHostInt64(record->urlOffset),
+                 OSSwapLittleToHostInt32(record->urlLength)) ||
+        !_inFile(map, OSSwapLittleToHostInt64(record->dataOffset),
+                 OSSwapLittleToHostInt64(record->dataLength)))
+      return [NSString stringWithFormat:@"corrupt record for sheet %u", i];
+  }
+  return nil;
+}
+
+
+static NSString *_recordURL(const css_file_map *map,
+                            const css_compiled_sheet *record) {
+  return [[[NSString alloc] initWithBytes:(const char *)map->bytes +
+                                OSSwapLittleToHostInt64(record->urlOffset)
+                                   length:OSSwapLittleToHostInt32(
+                                              record->urlLength)
+                                 encoding:NSUTF8StringEncoding] autorelease];
+}
+
+
+@implementation CSSStylesheet (compiled)
+
+
+// Append the receiver and its imports to |entries| (arrays of sheet, index
+// of the importing sheet and media), depth-first. Returns the reason why
+// the sheets can not be written, or nil.
+- (NSString*)_collectCompiled:(NSMutableArray*)entries
+                       parent:(uint32_t)parent
+                        media:(uint64_t)media {
+  // a sheet found in the parsed stylesheet cache only shares its sheet_
+  CSSStylesheet *sheet = parsed_ ? parsed_ : self;
+  if (!sheet->finalized_) {
+    return [NSString stringWithFormat:@"%@ has not been loaded",
+            url_ ? [url_ absoluteString] : @"the sheet"];
+  }
+  uint32_t index = (uint32_t)entries.count;
+  [entries addObject:[NSArray arrayWithObjects:sheet,
+                      [NSNumber numberWithUnsignedInt:parent],
+                      [NSNumber numberWithUnsignedLongLong:media], nil]];
+  for (CSSImport *import in sheet->imports_) {
+    NSString *reason = [import.sheet _collectCompiled:entries
+                                               parent:index
+                                                media:import.media];
+    if (reason) return reason;
+  }
+  return nil;
+}
+
+
+- (BOOL)writeCompiledToFile:(NSString*)path error:(NSError**)outError {
+  NSMutableArray *entries = [NSMutableArray array];
+  NSString *reason = [self _collectCompiled:entries parent:kNoParent media:0];
+  if (reason) {
+    if (outError)
+      *outError = [NSError libcssCompiledFileErrorWithPath:path reason:reason];
+    return NO;
+  }
+
+  uint32_t count = (uint32_t)entries.count, i;
+  NSMutableData *file = [NSMutableData dataWithLength:
+      sizeof(css_compiled_header) + count * sizeof(css_compiled_sheet)];
+  for (i = 0; i < count; i++) {
+    NSArray *entry = [entries objectAtIndex:i];
+    CSSStylesheet *sheet = [entry objectAtIndex:0];
+    NSData *url = [[sheet.url absoluteString]
+                   dataUsingEncoding:NSUTF8StringEncoding];
+    css_compiled_sheet record;
+    record.parent = OSSwapHostToLittleInt32(
+        [[entry objectAtIndex:1] unsignedIntValue]);
+    record.media = OSSwapHostToLittleInt64(
+        [[entry objectAtIndex:2] unsignedLongLongValue]);
+    record.urlOffset = OSSwapHostToLittleInt64(file.length);
+    record.urlLength = OSSwapHostToLittleInt32((uint32_t)url.length);
+    [file appendData:url];
+    uint8_t *data;
+    size_t length;
+    css_error status = css_stylesheet_serialise(sheet->sheet_, &css_cf_realloc,
+                                                NULL, &data, &length);
+    if (status != CSS_OK) {
+      if (outError) {
+        *outError = status != CSS_INVALID ?
+            [NSError libcssErrorFromStatus:status] :
+            [NSError libcssCompiledFileErrorWithPath:path reason:
+                [NSString stringWithFormat:@"%@ has rules which can not be "
+                                           @"serialised", sheet.url]];
+      }
+      return NO;
+    }
+    record.dataOffset = OSSwapHostToLittleInt64(file.length);
+    record.dataLength = OSSwapHostToLittleInt64(length);
+    [file appendBytes:data length:length];
+    css_cf_realloc(data, 0, NULL);
+    [file replaceBytesInRange:NSMakeRange(sizeof(css_compiled_header) +
+                                          i * sizeof(css_compiled_sheet),
+                                          sizeof(css_compiled_sheet))
+                    withBytes:&record];
+  }
+
+  css_compiled_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "CSSC", 4);
+  header.version = OSSwapHostToLittleInt32(kCSSCompiledFormatVersion);
+  header.libcssRevision = OSSwapHostToLittleInt32(kCSSLibcssRevision);
+  header.serialisedVersion =
+      OSSwapHostToLittleInt32(CSS_STYLESHEET_SERIALISED_VERSION);
+  header.sheetCount = OSSwapHostToLittleInt32(count);
+  header.fileSize = OSSwapHostToLittleInt64(file.length);
+  [file replaceBytesInRange:NSMakeRange(0, sizeof(header)) withBytes:&header];
+
+  return [file writeToFile:path options:NSAtomicWrite error:outError];
+}
+
+
+// Load sheet |index| of |map| into the receiver, and its imports, which
+// are the sheets from |*next| on
+- (BOOL)_loadCompiled:(const css_file_map*)map
+                index:(uint32_t)index
+                 next:(uint32_t*)next
+                error:(NSError**)outError {
+  const css_compiled_sheet *record = _record(map, index);
+  const css_compiled_header *header = map->bytes;
+  uint32_t count = OSSwapLittleToHostInt32(header->sheetCount);
+
+  // rebuild the rules straight from the mapping, without parsing
+  hasStartedLoading_ = 1;
+  css_error status = css_stylesheet_load_serialised(sheet_,
+      (const uint8_t *)map->bytes + OSSwapLittleToHostInt64(record->dataOffset),
+      (size_t)OSSwapLittleToHostInt64(record->dataLength));
+  if (status == CSS_INVALID) {
+    if (outError) {
+      *outError = [NSError libcssCompiledFileErrorWithPath:nil reason:
+          [NSString stringWithFormat:@"corrupt data for sheet %u", index]];
+    }
+    return NO;
+  }
+  if (status == CSS_OK) {
+    // reports the @import rules as pending
+    finalized_ = YES;
+    status = css_stylesheet_data_done(sheet_);
+  }
+  if (status == CSS_OK) return YES;
+  if (status != CSS_IMPORTS_PENDING) {
+    if (outError) *outError = CSSErrorFromStatus(status, allocTracker_, 0);
+    return NO;
+  }
+
+  while (1) {
+    lwc_string *relurl = NULL;
+    uint64_t media;
+    status = css_stylesheet_next_pending_import(sheet_, &relurl, &media);
+    if (status == CSS_INVALID) break;
+    assert(status == CSS_OK);
+
+    NSString *relurls = [NSString stringWithLWCString:relurl];
+    lwc_string_unref(relurl);
+    NSURL *url = [NSURL URLWithString:relurls relativeToURL:url_];
+    if (*next >= count ||
+        OSSwapLittleToHostInt32(_record(map, *next)->parent) != index ||
+        ![_recordURL(map, _record(map, *next))
+          isEqualToString:[url absoluteString]]) {
+      if (outError) {
+        *outError = [NSError libcssCompiledFileErrorWithPath:nil reason:
+            [NSString stringWithFormat:@"@import of %@ not found", url]];
+      }
+      return NO;
+    }
+
+    CSSStylesheet *sheet = [[CSSStylesheet alloc] initWithURL:url];
+    if (!sheet) {
+      if (outError) *outError = [NSError libcssErrorFromStatus:CSS_NOMEM];
+      return NO;
+    }
+    sheet.memoryLimit = self.memoryLimit;
+    if (![sheet _loadCompiled:map index:(*next)++ next:next error:outError]) {
+      [sheet release];
+      return NO;
+    }
+    css_stylesheet_register_import(sheet_, sheet->sheet_);
+    if (!imports_) imports_ = [[NSMutableArray alloc] init];
+    [imports_ addObject:[CSSImport importWithLoadedSheet:sheet media:media]];
+    [sheet release];
+  }
+  return YES;
+}
+
+
+- (id)initWithCompiledFile:(NSString*)path error:(NSError**)outError {
+  css_file_map map;
+  int err = css_file_map_open([path fileSystemRepresentation], &map);
+  if (err) {
+    if (outError) {
+      *outError = [NSError errorWithDomain:NSPOSIXErrorDomain code:err
+          userInfo:[NSDictionary dictionaryWithObject:path
+                                               forKey:NSFilePathErrorKey]];
+    }
+    [self release];
+    return nil;
+  }
+  css_file_map_sequential(&map);
+  NSString *reason = _validate(&map);
+  if (reason) {
+    if (outError)
+      *outError = [NSError libcssCompiledFileErrorWithPath:path reason:reason];
+    css_file_map_close(&map);
+    [self release];
+    return nil;
+  }
+
+  const css_compiled_header *header = map.bytes;
+  NSString *url = _recordURL(&map, _record(&map, 0));
+  if ((self = [self initWithURL:url.length ? [NSURL URLWithString:url]
+                                           : nil])) {
+    NSError *error = nil;
+    uint32_t next = 1;
+    BOOL loaded = [self _loadCompiled:&map index:0 next:&next error:&error];
+    if (loaded && next != OSSwapLittleToHostInt32(header->sheetCount)) {
+      error = [NSError libcssCompiledFileErrorWithPath:path
+                                                reason:@"sheets not imported"];
+      loaded = NO;
+    }
+    if (!loaded) {
+      if (outError) *outError = error;
+      [self release];
+      self = nil;
+    }
+  }
+  css_file_map_close(&map);
+  return self;
+}
+
+
+@end
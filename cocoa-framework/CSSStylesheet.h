@@ -1,20 +1,66 @@
 
 @class CSSContext;
+@class CSSImport;
+@class CSSImportBudget;
+
+#define kCSSDefaultMaxImportDepth 16
+#define kCSSDefaultMaxImportCount 256
 
 @interface CSSStylesheet : NSObject {
   struct css_stylesheet *sheet_;
+  struct css_arena *arena_;  // owns all memory of sheet_
+  struct css_alloc_tracker *allocTracker_;
+  NSMutableArray *imports_;  // CSSImports registered for our @imports
+  NSArray *importChain_;  // absolute URLs from the root sheet down to ours
+  CSSImportBudget *importBudget_;  // shared with every sheet we import
+  CSSImport *import_;  // if we were loaded for an @import (weak)
+  CSSStylesheet *parsed_;  // cached sheet whose sheet_ we share, if any
+  dispatch_queue_t queue_;  // runs asynchronous loads one at a time
   NSURL* url_;
   volatile uint32_t hasStartedLoading_;
+  BOOL finalized_;  // css_stylesheet_data_done has been called
 }
 
 @property(readonly, nonatomic) struct css_stylesheet *sheet;
 @property(readonly, nonatomic) NSURL* url;
 
+/**
+ * Maximum number of bytes libcss may allocate for this stylesheet, or 0 for
+ * no limit (the default). Parsing which would exceed the limit fails with a
+ * CSS_NOMEM error; such a sheet is incomplete and should be discarded.
+ * @imported sheets inherit the limit of the importing sheet (the first one,
+ * as imports of the same URL are shared; see CSSImportCache.h).
+ */
+@property(nonatomic) size_t memoryLimit;
+
+/**
+ * Number of bytes libcss holds for this stylesheet, i.e. the size of its
+ * arena, which is what memoryLimit is checked against
+ */
+@property(readonly, nonatomic) size_t memoryUsage;
+
+/**
+ * Limits on loading @imports: how deeply imports may nest (a sheet imported
+ * directly by this one is at depth 1) and how many @import rules may be
+ * followed in total by this sheet and everything it imports. Loading fails
+ * with an error naming the offending URL when a limit is exceeded, or when
+ * a sheet (indirectly) imports itself. Defaults to
+ * kCSSDefaultMaxImportDepth and kCSSDefaultMaxImportCount. Imported sheets
+ * share the limits of the sheet importing them.
+ */
+@property(nonatomic) NSUInteger maxImportDepth;
+@property(nonatomic) NSUInteger maxImportCount;
+
 - (id)initWithURL:(NSURL*)url;
 
 #pragma mark -
 #pragma mark Parsing data
 
+/**
+ * Appending to a sheet which has been finalized, or which shares the sheet
+ * of an identical one parsed before (see -loadData:withCallback:), fails
+ * with an error, as does finalizing such a sheet.
+ */
 - (BOOL)appendData:(NSData*)data
              error:(NSError**)outError
        expectsMore:(BOOL*)expectsMore;
@@ -25,12 +71,81 @@
 #pragma mark -
 #pragma mark Loading external data
 
-/// load |data| and invoke |callback| when loaded.
+/**
+ * load |data| and invoke |callback| when loaded. If the same bytes have
+ * been loaded before into a sheet with the same URL, memoryLimit and import
+ * limits, the sheet parsed then is shared instead of parsing them again (see
+ * CSSStylesheetCache.h).
+ */
 - (void)loadData:(NSData*)data withCallback:(void(^)(NSError *error))callback;
 
-/// load |url_| asynchronously and invoke |callback| when loaded.
+/**
+ * load the file at |path| and invoke |callback| when loaded. The file is
+ * memory-mapped and handed to libcss straight from the mapping, so unlike
+ * -loadData:withCallback: no NSData copy of it is made. libparserutils still
+ * copies the input into buffers of its own (converted to UTF-8) as it
+ * parses, which are freed when the sheet is finalized.
+ */
+- (void)loadContentsOfFile:(NSString*)path
+              withCallback:(void(^)(NSError *error))callback;
+
+/**
+ * load everything that can be read from |fd| (a file, pipe or socket) or
+ * |stream| and invoke |callback| when loaded. Data is handed to libcss as it
+ * arrives, so a sheet can be parsed while the process producing it is still
+ * writing it. This does not bound memory use, though: libparserutils copies
+ * the data into buffers of its own, which can grow to the size of the
+ * input. Reading blocks the calling thread until the end of the input.
+ * |fd| is not closed; |stream| is opened if needed but not closed.
+ */
+- (void)loadFromFileDescriptor:(int)fd
+                  withCallback:(void(^)(NSError *error))callback;
+- (void)loadFromInputStream:(NSInputStream*)stream
+               withCallback:(void(^)(NSError *error))callback;
+
+/**
+ * load |url_| asynchronously and invoke |callback| when loaded, on an
+ * arbitrary thread. file: URLs are loaded with
+ * -loadContentsOfFile:withCallback: on a global dispatch queue; other URLs
+ * are fetched on a network thread of the framework and parsed there as the
+ * data arrives, so neither the calling nor the main thread has to run its
+ * run loop.
+ */
 - (BOOL)loadFromRepresentedURLWithCallback:(void(^)(NSError *error))callback;
 
+#pragma mark -
+#pragma mark Loading in the background
+
+/**
+ * Variants of the methods above which parse on a background queue and
+ * invoke |callback| on |callbackQueue| (the main queue if NULL) instead of
+ * on the calling thread. Background operations on the same sheet run one at
+ * a time in the order they were started, each including the loading of its
+ * @imports, so e.g. a -finalize... always sees the data of the preceding
+ * -appendData... Mixing them with the synchronous methods on one sheet is
+ * not safe. @imports are fetched on the framework's network thread (see
+ * -loadFromRepresentedURLWithCallback:), so the main thread may block while
+ * waiting for an operation, as long as |callbackQueue| is not the main
+ * queue.
+ */
+- (void)appendData:(NSData*)data
+     callbackQueue:(dispatch_queue_t)callbackQueue
+      withCallback:(void(^)(NSError *error))callback;
+- (void)finalizeWithCallbackQueue:(dispatch_queue_t)callbackQueue
+                         callback:(void(^)(NSError *error))callback;
+- (void)loadData:(NSData*)data
+   callbackQueue:(dispatch_queue_t)callbackQueue
+    withCallback:(void(^)(NSError *error))callback;
+- (void)loadContentsOfFile:(NSString*)path
+             callbackQueue:(dispatch_queue_t)callbackQueue
+              withCallback:(void(^)(NSError *error))callback;
+- (void)loadFromFileDescriptor:(int)fd
+                 callbackQueue:(dispatch_queue_t)callbackQueue
+                  withCallback:(void(^)(NSError *error))callback;
+- (void)loadFromInputStream:(NSInputStream*)stream
+              callbackQueue:(dispatch_queue_t)callbackQueue
+               withCallback:(void(^)(NSError *error))callback;
+
 #pragma mark -
 #pragma mark Querying
 
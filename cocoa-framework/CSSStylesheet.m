@@ -3,9 +3,17 @@
 #import "NSURL-blocks.h"
 #import "NSError-css.h"
 #import "NSString-wapcaplet.h"
+#import "CSSImportCache.h"
+#import "CSSStylesheetCache.h"
 
 #import "internal.h"
 
+#import <errno.h>
+#import <unistd.h>
+
+// size of the buffer streams are read into
+#define kStreamBufferSize (64 * 1024)
+
 
 static css_error resolve_url(void *pw, const char *base, lwc_string *rel,
                              lwc_string **abs) {
@@ -25,22 +33,69 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
 }
 
 
+static size_t _arenaFootprint(void *pw) {
+  return css_arena_size((css_arena*)pw);
+}
+
+
 @implementation CSSStylesheet
 
 @synthesize url = url_,
             sheet = sheet_;
 
 
+// Parameters the sheet is created with. |url| lives as long as the
+// current autorelease pool.
+- (css_parse_params)_parseParams {
+  css_parse_params params;
+  params.level = CSS_LEVEL_DEFAULT;
+  params.charset = "UTF-8";
+  params.url = url_ ? [[url_ absoluteString] UTF8String] : "";
+  params.allow_quirks = false;
+  params.inline_style = false;
+  // a sheet loaded under other limits might not have loaded under ours
+  params.memory_limit = allocTracker_->limit;
+  params.max_import_depth = importBudget_->maxDepth;
+  params.max_import_count = importBudget_->maxCount;
+  return params;
+}
+
+
 - (id)initWithURL:(NSURL*)url {
   if (!(self = [super init])) return nil;
 
   url_ = [url retain];
-  const char *urlpch = url_ ? [[url_ absoluteString] UTF8String] : "";
-  bool allow_quirks = false;
-  bool inline_style = false;
+
+  // everything libcss allocates for the sheet dies with it, so allocate it
+  // all from an arena which is released in one go in -dealloc
+  arena_ = css_arena_create(0);
+  css_alloc_tracker *tracker =
+      arena_ ? css_arena_realloc(NULL, sizeof(css_alloc_tracker), arena_)
+             : NULL;
+  if (!tracker) {
+    [self release];
+    return nil;
+  }
+  memset(tracker, 0, sizeof(css_alloc_tracker));
+  tracker->alloc = &css_arena_realloc;
+  tracker->pw = arena_;
+  tracker->size = &css_arena_block_size;
+  // freed blocks mostly stay in the arena, so budget what it holds
+  tracker->footprint = &_arenaFootprint;
+  tracker->tag = CSS_ALLOC_STYLESHEET;
+  allocTracker_ = tracker;
+
+  queue_ = dispatch_queue_create("se.hunch.libcss.stylesheet", NULL);
+
+  importBudget_ = [[CSSImportBudget alloc] init];
+  importBudget_->maxDepth = kCSSDefaultMaxImportDepth;
+  importBudget_->maxCount = kCSSDefaultMaxImportCount;
+
+  css_parse_params params = [self _parseParams];
   css_error status =
-      css_stylesheet_create(CSS_LEVEL_DEFAULT, "UTF-8", urlpch, NULL,
-                            allow_quirks, inline_style, &css_cf_realloc, NULL,
+      css_stylesheet_create(params.level, params.charset, params.url, NULL,
+                            params.allow_quirks, params.inline_style,
+                            &css_tracking_realloc, tracker,
                             &dummy_url_resolver, self,
                             NULL, NULL, // TODO: css_import_notification_fn
                             &sheet_);
@@ -55,25 +110,90 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
 
 
 - (void)dealloc {
-  css_stylesheet_destroy(sheet_);
+  if (sheet_ && !parsed_) {
+    css_stylesheet_destroy(sheet_);
+  }
+  // imported sheets are owned by us, not by sheet_, and must outlive it
+  [imports_ makeObjectsPerformSelector:@selector(relinquish)];
+  [imports_ release];
+  [importChain_ release];
+  [importBudget_ release];
+  [parsed_ release];
+  if (queue_) dispatch_release(queue_);
+  css_arena_destroy(arena_);
   [super dealloc];
 }
 
 
+- (size_t)memoryLimit {
+  return allocTracker_->limit;
+}
+
+
+- (void)setMemoryLimit:(size_t)limit {
+  allocTracker_->limit = limit;
+}
+
+
+- (size_t)memoryUsage {
+  if (parsed_) return parsed_.memoryUsage;
+  return css_arena_size(arena_);
+}
+
+
+- (NSUInteger)maxImportDepth {
+  return importBudget_->maxDepth;
+}
+
+
+- (void)setMaxImportDepth:(NSUInteger)depth {
+  importBudget_->maxDepth = depth;
+}
+
+
+- (NSUInteger)maxImportCount {
+  return importBudget_->maxCount;
+}
+
+
+- (void)setMaxImportCount:(NSUInteger)count {
+  importBudget_->maxCount = count;
+}
+
+
 #pragma mark -
 #pragma mark Parsing data
 
 
-- (BOOL)appendData:(NSData*)data
-             error:(NSError**)outError
-       expectsMore:(BOOL*)expectsMore {
-  assert(data != nil);
+// Error for appending to or finalizing the sheet, or nil if that's fine
+- (NSError*)_checkLoadable {
+  if (parsed_) {
+    return [NSError libcssStateErrorWithReason:
+        @"stylesheet shares an identical, already parsed sheet"];
+  }
+  if (finalized_)
+    return [NSError libcssStateErrorWithReason:@"stylesheet is finalized"];
+  return nil;
+}
+
+
+- (BOOL)_appendBytes:(const void*)bytes
+              length:(size_t)length
+               error:(NSError**)outError
+         expectsMore:(BOOL*)expectsMore {
+  NSError *error = [self _checkLoadable];
+  if (error) {
+    if (outError) *outError = error;
+    if (expectsMore != nil) *expectsMore = NO;
+    return NO;
+  }
+  hasStartedLoading_ = 1;
   css_error status = css_stylesheet_append_data(sheet_,
-                                                (const uint8_t *)data.bytes,
-                                                data.length);
+                                                (const uint8_t *)bytes,
+                                                length);
   if (status != CSS_OK && status != CSS_NEEDDATA) {
     if (outError)
-      *outError = [NSError libcssErrorFromStatus:status];
+      *outError = CSSErrorFromStatus(status, allocTracker_, 0);
     if (expectsMore != nil) *expectsMore = NO;
     return NO;
   } else if (expectsMore != nil) {
@@ -82,43 +202,119 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
   return YES;
 }
 
+
+- (BOOL)appendData:(NSData*)data
+             error:(NSError**)outError
+       expectsMore:(BOOL*)expectsMore {
+  assert(data != nil);
+  return [self _appendBytes:data.bytes
+                     length:data.length
+                      error:outError
+                expectsMore:expectsMore];
+}
+
 // -------------
 
 
-- (void)_importNext:(void(^)(NSError*))callback {
-  callback = [callback copy];
+// Error for following an @import of |url|, or nil if that's fine
+- (NSError*)_checkImportOfURL:(NSURL*)url {
+  NSArray *chain = self.importChain;
+  NSString *reason = nil;
+  if ([chain containsObject:[url absoluteString]]) {
+    NSString *cycle = [[chain arrayByAddingObject:[url absoluteString]]
+                       componentsJoinedByString:@" -> "];
+    reason = [NSString stringWithFormat:@"@import cycle: %@", cycle];
+  } else if (chain.count > importBudget_->maxDepth) {  // depth of |url|
+    reason = [NSString stringWithFormat:
+        @"@import of %@ exceeds the maximum import depth of %lu",
+        url, (unsigned long)importBudget_->maxDepth];
+  } else if ((NSUInteger)OSAtomicIncrement32(&importBudget_->count) >
+             importBudget_->maxCount) {
+    reason = [NSString stringWithFormat:
+        @"@import of %@ exceeds the maximum of %lu imports",
+        url, (unsigned long)importBudget_->maxCount];
+  }
+  return reason ? [NSError libcssImportErrorWithURL:url reason:reason] : nil;
+}
 
-  lwc_string *relurl;
-  uint64_t media;
-  css_error status =
-      css_stylesheet_next_pending_import(sheet_, &relurl, &media);
 
-  if (status == CSS_INVALID) {
-    //NSLog(@"end of import chain -- invoking callback");
-    callback(nil);
-    [callback release];
+- (void)_loadImports:(void(^)(NSError*))callback {
+  // libcss only reveals the next pending @import once the previous one has
+  // been registered, so every import is registered (in document order) as
+  // soon as it is discovered and its sheet is filled in afterwards. Nothing
+  // selects from this sheet before |callback| has been invoked. Imports of
+  // a URL which is already cached (or being loaded) share its sheet.
+  NSMutableArray *imports = [NSMutableArray array];
+  NSError *error = nil;
+  while (1) {
+    lwc_string *relurl = NULL;
+    uint64_t media;
+    css_error status =
+        css_stylesheet_next_pending_import(sheet_, &relurl, &media);
+    if (status == CSS_INVALID) break;
+    assert(status == CSS_OK);
+
+    NSString *relurls = [NSString stringWithLWCString:relurl];
+    lwc_string_unref(relurl);
+    NSURL *url = [NSURL URLWithString:relurls relativeToURL:url_];
+    if ((error = [self _checkImportOfURL:url])) break;
+    CSSImport *import = [CSSImport acquireImportWithURL:url
+                                                  media:media
+                                               importer:self];
+    if (!import) {
+      error = [NSError libcssErrorFromStatus:CSS_NOMEM];
+      break;
+    }
+    if (import_ && ![import_ addDependency:import]) {
+      [import relinquish];
+      error = [NSError libcssImportErrorWithURL:url reason:
+          [NSString stringWithFormat:@"@import cycle through %@", url]];
+      break;
+    }
+    css_stylesheet_register_import(sheet_, import.sheet.sheet);
+    if (!imports_) imports_ = [[NSMutableArray alloc] init];
+    [imports_ addObject:import];
+    [imports addObject:import];
+  }
+  if (imports.count == 0) {
+    callback(error);
     return;
   }
-  assert(status == CSS_OK);
 
-  NSString *relurls = [NSString stringWithLWCString:relurl];
-  NSURL *url = [NSURL URLWithString:relurls relativeToURL:url_];
-  CSSStylesheet *sheet = [[CSSStylesheet alloc] initWithURL:url];
-  //NSLog(@"@import(%@)", url);
-
-  [sheet loadFromRepresentedURLWithCallback:^(NSError *error) {
-    // Note: even if there's an error we need to register the import
-    css_stylesheet_register_import(sheet_, sheet->sheet_);
-    [sheet release]; // no longer used since sheet->sheet_ was "eaten"
-    // This isn't very nice since multiple errors will only result in one
-    if (error) {
-      //NSLog(@"end of import chain -- error: %@", error);
-      callback(error);
-    } else {
-      [self _importNext:callback];
+  // wait for all registered imports to load, even if discovering further
+  // ones failed, as they hold references to this sheet and fill in its
+  // import list. When the last one is done, report the error of the first
+  // failed import in document order, if any, or else the discovery error
+  // (which comes after all registered imports).
+  NSUInteger count = imports.count;
+  NSError *discoveryError = [error retain];
+  __block int32_t pending = (int32_t)count;
+  NSMutableArray *errors = [[NSMutableArray alloc] initWithCapacity:count];
+  for (NSUInteger i = 0; i < count; i++)
+    [errors addObject:[NSNull null]];
+  callback = [callback copy];
+  void (^onImportLoaded)(NSUInteger, NSError*) =
+      ^(NSUInteger index, NSError *importError) {
+    if (importError) {
+      @synchronized(errors) {
+        [errors replaceObjectAtIndex:index withObject:importError];
+      }
     }
-    //callback(nil);
-    [callback release];
+    if (OSAtomicDecrement32(&pending) == 0) {
+      NSError *firstError = nil;
+      for (id e in errors) {
+        if (e != [NSNull null]) { firstError = e; break; }
+      }
+      callback(firstError ? firstError : discoveryError);
+      [callback release];
+      [errors release];
+      [discoveryError release];
+    }
+  };
+  [imports enumerateObjectsUsingBlock:^(id import, NSUInteger i, BOOL *stop) {
+    [import whenLoaded:^(NSError *e) {
+      onImportLoaded(i, e);
+    }];
   }];
 }
 
@@ -128,14 +324,20 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
   //callback = [callback copy];
   //int32_t startedAlready = OSAtomicAnd32Orig(1, &hasStartedLoading_);
   //startedAlready = startedAlready; // STFU, mr compiler
+  NSError *error = [self _checkLoadable];
+  if (error) {
+    callback(error);
+    return;
+  }
+  finalized_ = YES;
   css_error status = css_stylesheet_data_done(sheet_);
   if (status == CSS_OK) {
     callback(nil);
   } else if (status != CSS_IMPORTS_PENDING) {
-    callback([NSError libcssErrorFromStatus:status]);
+    callback(CSSErrorFromStatus(status, allocTracker_, 0));
   } else {
     // handle @imports
-    [self _importNext:callback];
+    [self _loadImports:callback];
   }
   //[callback release];
 }
@@ -145,16 +347,129 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
 #pragma mark Loading external data
 
 
+// Use |parsed|, an identical sheet which has already been loaded, in place
+// of our own (still empty) sheet
+- (void)_useParsedSheet:(CSSStylesheet*)parsed {
+  css_stylesheet_destroy(sheet_);
+  sheet_ = parsed->sheet_;
+  parsed_ = [parsed retain];
+  hasStartedLoading_ = 1;
+}
+
+
 - (void)loadData:(NSData*)data withCallback:(void(^)(NSError*))callback {
   NSError *err = nil;
-  //callback = [callback copy];
+  css_parse_params params = [self _parseParams];
+  if (!hasStartedLoading_) {
+    CSSStylesheet *parsed = [CSSStylesheetCache sheetForData:data
+                                                      params:&params];
+    if (parsed && parsed != self) {
+      [self _useParsedSheet:parsed];
+      callback(nil);
+      return;
+    }
+  }
+  callback = [callback copy];
+  void (^onLoaded)(NSError*) = ^(NSError *error) {
+    if (!error) {
+      css_parse_params loadedParams = [self _parseParams];
+      [CSSStylesheetCache addSheet:self forData:data params:&loadedParams];
+    }
+    callback(error);
+  };
   if (![self appendData:data error:&err expectsMore:nil]) {
     assert(err != nil);
     callback(err);
+  } else {
+    [self finalizeWithCallback:onLoaded];
+  }
+  [callback release];
+}
+
+
+- (void)loadContentsOfFile:(NSString*)path
+              withCallback:(void(^)(NSError*))callback {
+  css_file_map map;
+  int err = css_file_map_open([path fileSystemRepresentation], &map);
+  if (err) {
+    callback([NSError errorWithDomain:NSPOSIXErrorDomain code:err
+        userInfo:[NSDictionary dictionaryWithObject:path
+                                             forKey:NSFilePathErrorKey]]);
+    return;
+  }
+  css_file_map_sequential(&map);
+
+  NSError *error = nil;
+  // an empty file maps to NULL, which libcss rejects; it is an empty sheet
+  if (map.length > 0) {
+    [self _appendBytes:map.bytes length:map.length error:&error
+           expectsMore:NULL];
+  }
+  // libcss has copied what it needs
+  css_file_map_close(&map);
+  if (error) {
+    callback(error);
+  } else {
+    [self finalizeWithCallback:callback];
+  }
+}
+
+
+// Feed libcss what |reader| reads into a buffer of kStreamBufferSize bytes,
+// which is reused for every read, until it returns 0 (the end) or -1 (an
+// error)
+- (void)_loadByReading:(NSInteger(^)(uint8_t*, NSUInteger, NSError**))reader
+          withCallback:(void(^)(NSError*))callback {
+  uint8_t *buffer = css_cf_realloc(NULL, kStreamBufferSize, NULL);
+  if (!buffer) {
+    callback([NSError libcssErrorFromStatus:CSS_NOMEM]);
+    return;
+  }
+  NSError *error = nil;
+  NSInteger length;
+  while ((length = reader(buffer, kStreamBufferSize, &error)) > 0) {
+    if (![self _appendBytes:buffer
+                     length:(size_t)length
+                      error:&error
+                expectsMore:NULL])
+      break;
+  }
+  css_cf_realloc(buffer, 0, NULL);
+  if (error) {
+    callback(error);
   } else {
     [self finalizeWithCallback:callback];
   }
-  //[callback release];
+}
+
+
+- (void)loadFromFileDescriptor:(int)fd
+                  withCallback:(void(^)(NSError*))callback {
+  [self _loadByReading:^(uint8_t *buffer, NSUInteger size, NSError **error) {
+    ssize_t length;
+    do {
+      length = read(fd, buffer, size);
+    } while (length == -1 && errno == EINTR);
+    if (length == -1) {
+      *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno
+                               userInfo:nil];
+    }
+    return (NSInteger)length;
+  } withCallback:callback];
+}
+
+
+- (void)loadFromInputStream:(NSInputStream*)stream
+               withCallback:(void(^)(NSError*))callback {
+  if ([stream streamStatus] == NSStreamStatusNotOpen) [stream open];
+  [self _loadByReading:^(uint8_t *buffer, NSUInteger size, NSError **error) {
+    NSInteger length = [stream read:buffer maxLength:size];
+    if (length < 0) {
+      *error = [stream streamError];
+      if (!*error) *error = [NSError libcssErrorFromStatus:CSS_INVALID];
+    }
+    return length;
+  } withCallback:callback];
 }
 
 
@@ -162,6 +477,18 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
   assert(url_ != nil);
   assert(callback != nil);
   callback = [callback copy];
+  if ([url_ isFileURL]) {
+    // like other URLs, return before the file has been read
+    NSString *path = [url_ path];
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,
+                                             0), ^{
+      NSAutoreleasePool *pool = [NSAutoreleasePool new];
+      [self loadContentsOfFile:path withCallback:callback];
+      [callback release];
+      [pool drain];
+    });
+    return YES;
+  }
 
   return !![url_ fetchCSSWithOnResponseBlock:^(NSURLResponse *response) {
     // check response
@@ -174,12 +501,10 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
     return (NSError*)0;
   } onDataBlock:^(NSData *data) {
     // append received data
-    css_error status = css_stylesheet_append_data(sheet_,
-                                                  (const uint8_t *)data.bytes,
-                                                  data.length);
-    if (status != CSS_OK && status != CSS_NEEDDATA)
-      return [NSError libcssErrorFromStatus:status];
-    return (NSError*)0;
+    NSError *error = nil;
+    [self _appendBytes:data.bytes length:data.length error:&error
+           expectsMore:NULL];
+    return error;
   } onCompleteBlock:^(NSError *error) {
     // finalize creation
     if (!error) {
@@ -192,10 +517,123 @@ static css_error dummy_url_resolver(void *pw, const char *base, lwc_string *rel,
 }
 
 
+#pragma mark -
+#pragma mark Loading in the background
+
+
+// Run |operation| on queue_, holding back the operations after it until it
+// has called its |done| block, then invoke |callback| on |callbackQueue|
+- (void)_enqueue:(void(^)(void(^done)(NSError*)))operation
+   callbackQueue:(dispatch_queue_t)callbackQueue
+        callback:(void(^)(NSError*))callback {
+  assert(callback != nil);
+  if (!callbackQueue) callbackQueue = dispatch_get_main_queue();
+  dispatch_retain(callbackQueue);
+  dispatch_queue_t queue = queue_;
+  dispatch_async(queue, ^{
+    NSAutoreleasePool *pool = [NSAutoreleasePool new];
+    // loading @imports completes on other threads, after this block
+    dispatch_suspend(queue);
+    operation(^(NSError *error) {
+      dispatch_async(callbackQueue, ^{
+        callback(error);
+      });
+      dispatch_release(callbackQueue);
+      dispatch_resume(queue);
+    });
+    [pool drain];
+  });
+}
+
+
+- (void)appendData:(NSData*)data
+     callbackQueue:(dispatch_queue_t)callbackQueue
+      withCallback:(void(^)(NSError*))callback {
+  [self _enqueue:^(void(^done)(NSError*)) {
+    NSError *error = nil;
+    [self appendData:data error:&error expectsMore:NULL];
+    done(error);
+  } callbackQueue:callbackQueue callback:callback];
+}
+
+
+- (void)finalizeWithCallbackQueue:(dispatch_queue_t)callbackQueue
+                         callback:(void(^)(NSError*))callback {
+  [self _enqueue:^(void(^done)(NSError*)) {
+    [self finalizeWithCallback:done];
+  } callbackQueue:callbackQueue callback:callback];
+}
+
+
+- (void)loadData:(NSData*)data
+   callbackQueue:(dispatch_queue_t)callbackQueue
+    withCallback:(void(^)(NSError*))callback {
+  [self _enqueue:^(void(^done)(NSError*)) {
+    [self loadData:data withCallback:done];
+  } callbackQueue:callbackQueue callback:callback];
+}
+
+
+- (void)loadContentsOfFile:(NSString*)path
+             callbackQueue:(dispatch_queue_t)callbackQueue
+              withCallback:(void(^)(NSError*))callback {
+  [self _enqueue:^(void(^done)(NSError*)) {
+    [self loadContentsOfFile:path withCallback:done];
+  } callbackQueue:callbackQueue callback:callback];
+}
+
+
+- (void)loadFromFileDescriptor:(int)fd
+                 callbackQueue:(dispatch_queue_t)callbackQueue
+                  withCallback:(void(^)(NSError*))callback {
+  [self _enqueue:^(void(^done)(NSError*)) {
+    [self loadFromFileDescriptor:fd withCallback:done];
+  } callbackQueue:callbackQueue callback:callback];
+}
+
+
+- (void)loadFromInputStream:(NSInputStream*)stream
+              callbackQueue:(dispatch_queue_t)callbackQueue
+               withCallback:(void(^)(NSError*))callback {
+  [self _enqueue:^(void(^done)(NSError*)) {
+    [self loadFromInputStream:stream withCallback:done];
+  } callbackQueue:callbackQueue callback:callback];
+}
+
+
 - (NSString*)description {
   return [NSString stringWithFormat:@"<%@@%p url=%@>",
       NSStringFromClass([self class]), self, url_];
 }
 
 
+@end
+
+
+@implementation CSSStylesheet (CSSImport)
+
+
+- (NSArray*)importChain {
+  if (importChain_) return importChain_;
+  // (the root of the chain, at depth 0)
+  return [NSArray arrayWithObject:url_ ? [url_ absoluteString] : @"<data>"];
+}
+
+
+- (CSSImportBudget*)importBudget {
+  return importBudget_;
+}
+
+
+- (void)setImport:(CSSImport*)import
+      importChain:(NSArray*)chain
+           budget:(CSSImportBudget*)budget {
+  import_ = import;
+  [importChain_ release];
+  importChain_ = [chain copy];
+  [importBudget_ release];
+  importBudget_ = [budget retain];
+}
+
+
 @end
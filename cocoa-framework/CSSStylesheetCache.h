@@ -0,0 +1,61 @@
+@class CSSStylesheet;
+
+/// Arguments to css_stylesheet_create which affect the parsed result, and
+/// the limits a load has to stay within
+typedef struct {
+  css_language_level level;
+  const char *charset;
+  const char *url;
+  bool allow_quirks;
+  bool inline_style;
+  size_t memory_limit;  // see -[CSSStylesheet memoryLimit]
+  size_t max_import_depth;
+  size_t max_import_count;
+} css_parse_params;
+
+/// Counters of the parsed stylesheet cache (see
+/// +[CSS stylesheetCacheStatistics])
+typedef struct {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t insertions;
+  uint64_t evictions;
+  size_t entries;
+  size_t bytes;  // source data plus parsed sheets
+  size_t limit;
+} css_sheet_cache_stats;
+
+/**
+ * Process-wide cache of parsed stylesheets keyed by the source bytes and the
+ * parameters and limits they were loaded with, so that byte-identical payloads (the
+ * same theme loaded for many tenants) are parsed once and the resulting
+ * css_stylesheet is shared by every CSSStylesheet loading them.
+ *
+ * Entries are found by a 64-bit hash of the bytes and the parameters, and
+ * confirmed by comparing the bytes. The least recently used entries are
+ * evicted when the cache grows beyond its limit, counting the source data
+ * and the memory libcss allocated for each sheet. Sheets in use elsewhere
+ * stay alive until their last user is gone.
+ */
+@interface CSSStylesheetCache : NSObject {
+}
+
+/// The sheet parsed from |data| with |params|, or nil
++ (CSSStylesheet*)sheetForData:(NSData*)data
+                        params:(const css_parse_params*)params;
+
+/// Cache |sheet|, which has been completely loaded from |data| and |params|
++ (void)addSheet:(CSSStylesheet*)sheet
+         forData:(NSData*)data
+          params:(const css_parse_params*)params;
+
+/// Maximum size in bytes of the cache (default 32 MB), 0 disables it
++ (size_t)limit;
++ (void)setLimit:(size_t)limit;
+
++ (void)getStatistics:(css_sheet_cache_stats*)stats;
+
+/// Evict every entry
++ (void)purge;
+
+@end
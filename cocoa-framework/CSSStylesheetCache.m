@@ -0,0 +1,255 @@
+#import "CSSStylesheetCache.h"
+#import "CSSStylesheet.h"
+
+#import "internal.h"
+
+#import <pthread.h>
+
+#define kSheetCacheBuckets 256
+#define kSheetCacheDefaultLimit (32 * 1024 * 1024)
+
+typedef struct sheet_cache_entry {
+  struct sheet_cache_entry *next;  // in its bucket
+  struct sheet_cache_entry *newer, *older;  // in LRU order
+  uint64_t hash;
+  NSData *data;  // immutable copy, retained
+  NSString *url;
+  NSString *charset;
+  css_language_level level;
+  bool allow_quirks;
+  bool inline_style;
+  size_t memory_limit;
+  size_t max_import_depth;
+  size_t max_import_count;
+  CSSStylesheet *sheet;  // retained
+  size_t size;
+} sheet_cache_entry;
+
+static struct {
+  sheet_cache_entry *buckets[kSheetCacheBuckets];
+  sheet_cache_entry *newest, *oldest;
+  css_sheet_cache_stats stats;
+} gSheetCache_ = { .stats = { .limit = kSheetCacheDefaultLimit } };
+
+static pthread_mutex_t gSheetCacheLock_ = PTHREAD_MUTEX_INITIALIZER;
+
+// ----------------------------------------------------------------------------
+// Hashing
+
+static inline uint64_t _rotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+
+static inline uint64_t _fmix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  return h ^ (h >> 33);
+}
+
+
+// Word-at-a-time hash in the manner of MurmurHash3's 64-bit mixing
+static uint64_t _hashBytes(const uint8_t *p, size_t length, uint64_t seed) {
+  const uint64_t c1 = 0x87c37b91114253d5ull, c2 = 0x4cf5ad432745937full;
+  uint64_t h = seed ^ (length * c1);
+  size_t n = length;
+  for (; n >= 8; n -= 8, p += 8) {
+    uint64_t k;
+    memcpy(&k, p, 8);
+    h ^= _rotl(k * c1, 31) * c2;
+    h = _rotl(h, 27) * 5 + 0x52dce729;
+  }
+  uint64_t k = 0;
+  switch (n) {
+    case 7: k ^= (uint64_t)p[6] << 48;
+    case 6: k ^= (uint64_t)p[5] << 40;
+    case 5: k ^= (uint64_t)p[4] << 32;
+    case 4: k ^= (uint64_t)p[3] << 24;
+    case 3: k ^= (uint64_t)p[2] << 16;
+    case 2: k ^= (uint64_t)p[1] << 8;
+    case 1: k ^= (uint64_t)p[0];
+      h ^= _rotl(k * c1, 31) * c2;
+  }
+  return _fmix(h);
+}
+
+
+static uint64_t _hash(NSData *data, const css_parse_params *params) {
+  uint64_t seed = ((uint64_t)params->level << 2) |
+                  (params->allow_quirks ? 2 : 0) |
+                  (params->inline_style ? 1 : 0);
+  const char *url = params->url ? params->url : "";
+  const char *charset = params->charset ? params->charset : "";
+  seed = _hashBytes((const uint8_t *)url, strlen(url), seed);
+  seed = _hashBytes((const uint8_t *)charset, strlen(charset), seed);
+  return _hashBytes((const uint8_t *)data.bytes, data.length, seed);
+}
+
+
+static BOOL _entryMatches(sheet_cache_entry *entry, uint64_t hash,
+                          NSData *data, const css_parse_params *params) {
+  return entry->hash == hash &&
+         entry->level == params->level &&
+         entry->allow_quirks == params->allow_quirks &&
+         entry->inline_style == params->inline_style &&
+         entry->memory_limit == params->memory_limit &&
+         entry->max_import_depth == params->max_import_depth &&
+         entry->max_import_count == params->max_import_count &&
+         strcmp(entry->url.UTF8String, params->url ? params->url : "") == 0 &&
+         strcmp(entry->charset.UTF8String,
+                params->charset ? params->charset : "") == 0 &&
+         entry->data.length == data.length &&
+         memcmp(entry->data.bytes, data.bytes, data.length) == 0;
+}
+
+// ----------------------------------------------------------------------------
+// Entries and LRU list, all called with gSheetCacheLock_ held
+
+static void _unlinkLRU(sheet_cache_entry *entry) {
+  if (entry->newer) entry->newer->older = entry->older;
+  else gSheetCache_.newest = entry->older;
+  if (entry->older) entry->older->newer = entry->newer;
+  else gSheetCache_.oldest = entry->newer;
+  entry->newer = entry->older = NULL;
+}
+
+
+static void _linkNewest(sheet_cache_entry *entry) {
+  entry->older = gSheetCache_.newest;
+  entry->newer = NULL;
+  if (gSheetCache_.newest) gSheetCache_.newest->newer = entry;
+  gSheetCache_.newest = entry;
+  if (!gSheetCache_.oldest) gSheetCache_.oldest = entry;
+}
+
+
+static void _removeEntry(sheet_cache_entry *entry) {
+  sheet_cache_entry **p =
+      &gSheetCache_.buckets[entry->hash & (kSheetCacheBuckets - 1)];
+  while (*p != entry) p = &(*p)->next;
+  *p = entry->next;
+  _unlinkLRU(entry);
+  gSheetCache_.stats.entries--;
+  gSheetCache_.stats.bytes -= entry->size;
+  [entry->data release];
+  [entry->url release];
+  [entry->charset release];
+  [entry->sheet release];
+  css_cf_realloc(entry, 0, 0);
+}
+
+
+static void _evictToLimit(size_t limit) {
+  while (gSheetCache_.oldest && gSheetCache_.stats.bytes > limit) {
+    _removeEntry(gSheetCache_.oldest);
+    gSheetCache_.stats.evictions++;
+  }
+}
+
+// ----------------------------------------------------------------------------
+
+@implementation CSSStylesheetCache
+
+
++ (CSSStylesheet*)sheetForData:(NSData*)data
+                        params:(const css_parse_params*)params {
+  uint64_t hash = _hash(data, params);
+  CSSStylesheet *sheet = nil;
+  pthread_mutex_lock(&gSheetCacheLock_);
+  sheet_cache_entry *entry =
+      gSheetCache_.buckets[hash & (kSheetCacheBuckets - 1)];
+  for (; entry; entry = entry->next) {
+    if (_entryMatches(entry, hash, data, params)) break;
+  }
+  if (entry) {
+    _unlinkLRU(entry);
+    _linkNewest(entry);
+    sheet = [entry->sheet retain];
+    gSheetCache_.stats.hits++;
+  } else {
+    gSheetCache_.stats.misses++;
+  }
+  pthread_mutex_unlock(&gSheetCacheLock_);
+  return [sheet autorelease];
+}
+
+
++ (void)addSheet:(CSSStylesheet*)sheet
+         forData:(NSData*)data
+          params:(const css_parse_params*)params {
+  size_t size = data.length + sheet.memoryUsage;
+  uint64_t hash = _hash(data, params);
+  pthread_mutex_lock(&gSheetCacheLock_);
+  if (size > gSheetCache_.stats.limit) {
+    pthread_mutex_unlock(&gSheetCacheLock_);
+    return;
+  }
+  sheet_cache_entry **bucket =
+      &gSheetCache_.buckets[hash & (kSheetCacheBuckets - 1)];
+  sheet_cache_entry *entry;
+  for (entry = *bucket; entry; entry = entry->next) {
+    // already added by a concurrent load of the same data
+    if (_entryMatches(entry, hash, data, params)) break;
+  }
+  if (!entry &&
+      (entry = css_cf_realloc(NULL, sizeof(sheet_cache_entry), 0))) {
+    memset(entry, 0, sizeof(sheet_cache_entry));
+    entry->hash = hash;
+    entry->data = [data copy];
+    entry->url = [[NSString alloc] initWithUTF8String:
+                  params->url ? params->url : ""];
+    entry->charset = [[NSString alloc] initWithUTF8String:
+                      params->charset ? params->charset : ""];
+    entry->level = params->level;
+    entry->allow_quirks = params->allow_quirks;
+    entry->inline_style = params->inline_style;
+    entry->memory_limit = params->memory_limit;
+    entry->max_import_depth = params->max_import_depth;
+    entry->max_import_count = params->max_import_count;
+    entry->sheet = [sheet retain];
+    entry->size = size;
+    entry->next = *bucket;
+    *bucket = entry;
+    _linkNewest(entry);
+    gSheetCache_.stats.entries++;
+    gSheetCache_.stats.bytes += size;
+    gSheetCache_.stats.insertions++;
+    _evictToLimit(gSheetCache_.stats.limit);
+  }
+  pthread_mutex_unlock(&gSheetCacheLock_);
+}
+
+
++ (size_t)limit {
+  pthread_mutex_lock(&gSheetCacheLock_);
+  size_t limit = gSheetCache_.stats.limit;
+  pthread_mutex_unlock(&gSheetCacheLock_);
+  return limit;
+}
+
+
++ (void)setLimit:(size_t)limit {
+  pthread_mutex_lock(&gSheetCacheLock_);
+  gSheetCache_.stats.limit = limit;
+  _evictToLimit(limit);
+  pthread_mutex_unlock(&gSheetCacheLock_);
+}
+
+
++ (void)getStatistics:(css_sheet_cache_stats*)stats {
+  pthread_mutex_lock(&gSheetCacheLock_);
+  *stats = gSheetCache_.stats;
+  pthread_mutex_unlock(&gSheetCacheLock_);
+}
+
+
++ (void)purge {
+  pthread_mutex_lock(&gSheetCacheLock_);
+  _evictToLimit(0);
+  pthread_mutex_unlock(&gSheetCacheLock_);
+}
+
+
+@end
@@ -4,4 +4,9 @@ extern NSString *CSSErrorDomain;
 @interface NSError (CSS)
 + (NSError*)libcssErrorFromStatus:(int)status;
 + (NSError*)libcssHTTPErrorWithStatusCode:(int)status;
++ (NSError*)libcssMemoryLimitErrorWithLimit:(size_t)limit;
++ (NSError*)libcssImportErrorWithURL:(NSURL*)url reason:(NSString*)reason;
++ (NSError*)libcssCompiledFileErrorWithPath:(NSString*)path
+                                     reason:(NSString*)reason;
++ (NSError*)libcssStateErrorWithReason:(NSString*)reason;
 @end
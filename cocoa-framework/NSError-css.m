@@ -19,4 +19,37 @@ NSString *CSSErrorDomain = @"CSS";
   return [NSError errorWithDomain:NSURLErrorDomain code:status userInfo:info];
 }
 
++ (NSError*)libcssMemoryLimitErrorWithLimit:(size_t)limit {
+  NSString *msg = [NSString stringWithFormat:
+      @"Memory limit of %lu bytes exceeded", (unsigned long)limit];
+  NSDictionary *info =
+      [NSDictionary dictionaryWithObject:msg forKey:NSLocalizedDescriptionKey];
+  return [NSError errorWithDomain:CSSErrorDomain code:CSS_NOMEM userInfo:info];
+}
+
++ (NSError*)libcssImportErrorWithURL:(NSURL*)url reason:(NSString*)reason {
+  NSDictionary *info = [NSDictionary dictionaryWithObjectsAndKeys:
+      reason, NSLocalizedDescriptionKey, url, NSURLErrorKey, nil];
+  return [NSError errorWithDomain:CSSErrorDomain code:CSS_INVALID
+                         userInfo:info];
+}
+
++ (NSError*)libcssCompiledFileErrorWithPath:(NSString*)path
+                                     reason:(NSString*)reason {
+  NSString *msg = [NSString stringWithFormat:
+      @"Can not use compiled stylesheet: %@", reason];
+  NSDictionary *info = [NSDictionary dictionaryWithObjectsAndKeys:
+      msg, NSLocalizedDescriptionKey, path, NSFilePathErrorKey, nil];
+  return [NSError errorWithDomain:CSSErrorDomain code:CSS_INVALID
+                         userInfo:info];
+}
+
++ (NSError*)libcssStateErrorWithReason:(NSString*)reason {
+  NSDictionary *info =
+      [NSDictionary dictionaryWithObject:reason
+                                  forKey:NSLocalizedDescriptionKey];
+  return [NSError errorWithDomain:CSSErrorDomain code:CSS_INVALID
+                         userInfo:info];
+}
+
 @end
@@ -6,3 +6,31 @@
 /// returns a new reference (not autoreleased) i.e. implies lwc_string_ref.
 - (struct lwc_string_s*)LWCString;
 @end
+
+@interface NSArray (wapcaplet)
+
+/**
+ * Interns all strings of the receiver and returns them as a new
+ * css_cf_realloc'd array of new references, ready to be returned from a
+ * node_classes handler (libcss unrefs and frees it). All strings are looked
+ * up in the intern cache under a single lock, and the misses are interned
+ * with a single lwc_intern_strings call. Returns NULL for an empty array or
+ * on failure.
+ */
+- (struct lwc_string_s**)LWCStringArray;
+@end
+
+/// Counters of the cache behind -[NSString LWCString]
+typedef struct {
+  uint64_t lookups;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;  // strings replaced by a colliding one
+  uint64_t resizes;
+  uint64_t slots;      // size of the current table
+  uint64_t used;       // cached strings
+  uint64_t migrating;  // slots of the previous table not yet migrated
+  uint64_t bytes;      // total length of the cached strings
+} css_lwc_cache_stats;
+
+void css_lwc_cache_get_stats(css_lwc_cache_stats *stats);
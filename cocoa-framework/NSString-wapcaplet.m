@@ -1,19 +1,420 @@
 #import "NSString-wapcaplet.h"
 #import <libwapcaplet/libwapcaplet.h>
+#import "css-lwc-lock.h"
+#import "css-atoms.h"
+#import "css-lwc-intern.h"
+#import "css-cf-realloc.h"
+#import "css-alloc-stats.h"
 
-@implementation NSString (wapcaplet)
+/**
+ * Immutable string backed directly by the bytes of an interned lwc_string,
+ * which it keeps a reference to for its lifetime. Only used for ASCII data
+ * (the vast majority of CSS identifiers and URLs) where every byte is one
+ * unichar, so no transcoding or copying is needed.
+ */
+@interface CSSLWCString : NSString {
+  lwc_string *str_;
+  const char *bytes_;
+  NSUInteger length_;
+}
+- (id)initWithLWCString:(lwc_string*)str;
+@end
 
-+ (NSString*)stringWithLWCString:(lwc_string*)str {
-  return [[[NSString alloc] initWithBytes:lwc_string_data(str)
-                                   length:lwc_string_length(str)
-                                 encoding:NSUTF8StringEncoding] autorelease];
+@implementation CSSLWCString
+
+- (id)initWithLWCString:(lwc_string*)str {
+  if (!(self = [super init])) return nil;
+  str_ = lwc_string_ref(str);
+  bytes_ = lwc_string_data(str);
+  length_ = lwc_string_length(str);
+  return self;
+}
+
+- (void)dealloc {
+  lwc_string_unref(str_);
+  [super dealloc];
+}
+
+- (NSUInteger)length {
+  return length_;
+}
+
+- (unichar)characterAtIndex:(NSUInteger)index {
+  if (index >= length_) {
+    [NSException raise:NSRangeException format:@"index %lu out of bounds",
+                                               (unsigned long)index];
+  }
+  return (unichar)bytes_[index];
+}
+
+- (void)getCharacters:(unichar*)buffer range:(NSRange)range {
+  if (NSMaxRange(range) > length_) {
+    [NSException raise:NSRangeException format:@"range %@ out of bounds",
+                                               NSStringFromRange(range)];
+  }
+  const char *p = bytes_ + range.location;
+  NSUInteger i;
+  for (i = 0; i < range.length; i++)
+    buffer[i] = (unichar)p[i];
+}
+
+- (NSStringEncoding)fastestEncoding {
+  return NSASCIIStringEncoding;
+}
+
+- (id)copyWithZone:(NSZone*)zone {
+  return [self retain];
 }
 
 - (lwc_string*)LWCString {
-  NSData *data = [self dataUsingEncoding:NSUTF8StringEncoding];
+  return lwc_string_ref(str_);
+}
+
+@end
+
+
+#pragma mark -
+#pragma mark Intern cache
+
+/**
+ * Direct-mapped cache of NSString -> lwc_string, so that strings which are
+ * interned over and over again (element names, classes and ids looked up by
+ * selection handlers) are neither re-encoded nor re-hashed by libwapcaplet.
+ * A colliding string simply replaces the previous occupant, which bounds the
+ * cache to the size of its table.
+ *
+ * When more than a quarter of the recent insertions (at least half a table
+ * worth) evicted another string, the table is doubled, up to
+ * kLWCCacheMaxSize slots. The previous table is then migrated
+ * kLWCCacheMigrateStep slots per lookup instead of all at once, and probed
+ * for strings not yet moved.
+ *
+ * The cache is guarded by css_lwc_lock, which is only held for lookups and
+ * insertions; strings are interned without it.
+ */
+#define kLWCCacheInitialSize 1024
+#define kLWCCacheMaxSize (64 * 1024)
+#define kLWCCacheMigrateStep 16
+
+typedef struct {
+  NSString *key;      // immutable copy, retained
+  lwc_string *value;  // referenced
+  NSUInteger hash;    // [key hash]
+} lwc_cache_entry;
+
+typedef struct {
+  lwc_cache_entry *entries;
+  NSUInteger size;          // slots in |entries|, a power of two
+  lwc_cache_entry *old;     // table being migrated, or NULL
+  NSUInteger oldSize;
+  NSUInteger migrated;      // slots of |old| migrated so far
+  NSUInteger used;          // occupied slots in both tables
+  uint64_t bytes;           // total length of the cached strings
+  uint64_t lookups, hits, misses, evictions, resizes;
+  uint64_t windowInserts;   // insertions since the last resize ...
+  uint64_t windowEvictions; // ... and how many of them evicted a string
+} lwc_cache;
+
+static lwc_cache gLWCCache_;
+
+
+static lwc_cache_entry *_cacheAllocTable(NSUInteger size) {
+  size_t bytes = size * sizeof(lwc_cache_entry);
+  lwc_cache_entry *entries =
+      css_tracking_realloc(NULL, bytes, &css_alloc_tracker_strings);
+  if (entries) memset(entries, 0, bytes);
+  return entries;
+}
+
+
+static void _cacheClearEntry(lwc_cache_entry *entry) {
+  gLWCCache_.bytes -= lwc_string_length(entry->value);
+  gLWCCache_.used--;
+  [entry->key release];
+  lwc_string_unref(entry->value);
+  entry->key = nil;
+  entry->value = NULL;
+}
+
+
+// Move the next |count| slots of the old table into the current one
+static void _cacheMigrate(NSUInteger count) {
+  lwc_cache *c = &gLWCCache_;
+  for (; count && c->migrated < c->oldSize; count--, c->migrated++) {
+    lwc_cache_entry *entry = &c->old[c->migrated];
+    if (!entry->key) continue;
+    lwc_cache_entry *slot = &c->entries[entry->hash & (c->size - 1)];
+    if (slot->key) {
+      _cacheClearEntry(entry);  // the current table wins
+    } else {
+      *slot = *entry;
+      entry->key = nil;
+      entry->value = NULL;
+    }
+  }
+  if (c->old && c->migrated == c->oldSize) {
+    css_tracking_realloc(c->old, 0, &css_alloc_tracker_strings);
+    c->old = NULL;
+    c->oldSize = 0;
+    c->migrated = 0;
+  }
+}
+
+
+static void _cacheGrow(void) {
+  lwc_cache *c = &gLWCCache_;
+  lwc_cache_entry *entries = _cacheAllocTable(c->size * 2);
+  if (!entries) return;
+  c->old = c->entries;
+  c->oldSize = c->size;
+  c->migrated = 0;
+  c->entries = entries;
+  c->size *= 2;
+  c->windowInserts = 0;
+  c->windowEvictions = 0;
+  c->resizes++;
+}
+
+
+static inline BOOL _entryMatches(lwc_cache_entry *entry, NSString *key) {
+  return entry->key && (entry->key == key ||
+                        [entry->key isEqualToString:key]);
+}
+
+
+// Must be called with css_lwc_lock held
+static lwc_string *_cacheLookup(NSString *key, NSUInteger hash) {
+  lwc_cache *c = &gLWCCache_;
+  if (!c->entries) {
+    if (!(c->entries = _cacheAllocTable(kLWCCacheInitialSize))) return NULL;
+    c->size = kLWCCacheInitialSize;
+  }
+  if (c->old) _cacheMigrate(kLWCCacheMigrateStep);
+  c->lookups++;
+
+  lwc_cache_entry *entry = &c->entries[hash & (c->size - 1)];
+  if (!_entryMatches(entry, key) && c->old) {
+    entry = &c->old[hash & (c->oldSize - 1)];
+    if (!_entryMatches(entry, key)) entry = NULL;
+  } else if (!_entryMatches(entry, key)) {
+    entry = NULL;
+  }
+  if (!entry) {
+    c->misses++;
+    return NULL;
+  }
+  c->hits++;
+  return lwc_string_ref(entry->value);
+}
+
+
+// Must be called with css_lwc_lock held, after a _cacheLookup miss
+static void _cacheInsert(NSString *key, NSUInteger hash, lwc_string *value) {
+  lwc_cache *c = &gLWCCache_;
+  if (!c->entries) return;
+  lwc_cache_entry *entry = &c->entries[hash & (c->size - 1)];
+  // another thread may have cached the string since the lookup
+  if (_entryMatches(entry, key)) return;
+  c->windowInserts++;
+  if (entry->key) {
+    _cacheClearEntry(entry);
+    c->evictions++;
+    c->windowEvictions++;
+  }
+  entry->key = [key copy];
+  entry->value = lwc_string_ref(value);
+  entry->hash = hash;
+  c->used++;
+  c->bytes += lwc_string_length(value);
+
+  if (c->windowInserts >= c->size / 2) {
+    if (!c->old && c->size < kLWCCacheMaxSize &&
+        c->windowEvictions * 4 > c->windowInserts) {
+      _cacheGrow();
+    } else if (c->windowInserts >= c->size) {
+      c->windowInserts = 0;  // start a new window
+      c->windowEvictions = 0;
+    }
+  }
+}
+
+
+void css_lwc_cache_get_stats(css_lwc_cache_stats *stats) {
+  lwc_cache *c = &gLWCCache_;
+  css_lwc_lock();
+  stats->lookups = c->lookups;
+  stats->hits = c->hits;
+  stats->misses = c->misses;
+  stats->evictions = c->evictions;
+  stats->resizes = c->resizes;
+  stats->slots = c->size;
+  stats->used = c->used;
+  stats->migrating = c->oldSize - c->migrated;
+  stats->bytes = c->bytes;
+  css_lwc_unlock();
+}
+
+
+static lwc_string *_intern(NSString *string) {
   lwc_string *str = NULL;
+  CFStringRef cfstr = (CFStringRef)string;
+
+  // fast path: the string is already backed by UTF-8 compatible bytes. Only
+  // taken if those are ASCII up to a NUL after exactly |length| characters,
+  // so that embedded NULs and multi-byte characters are encoded below.
+  CFIndex length = CFStringGetLength(cfstr);
+  const char *cstr = CFStringGetCStringPtr(cfstr, kCFStringEncodingUTF8);
+  if (!cstr) cstr = CFStringGetCStringPtr(cfstr, kCFStringEncodingASCII);
+  CFIndex ascii = 0;
+  if (cstr) {
+    while (cstr[ascii] && !(cstr[ascii] & 0x80)) ascii++;
+  }
+  if (cstr && ascii == length) {
+    int atom = css_atom_lookup(cstr, length);
+    if (atom >= 0) return lwc_string_ref(css_atoms[atom]);
+    lwc_intern_string(cstr, (size_t)length, &str);
+    return str;
+  }
+
+  // short strings are encoded on the stack
+  char buf[256];
+  CFIndex used = 0;
+  if (CFStringGetBytes(cfstr, CFRangeMake(0, length), kCFStringEncodingUTF8,
+                       0, false, (UInt8*)buf, sizeof(buf), &used) == length) {
+    lwc_intern_string(buf, (size_t)used, &str);
+    return str;
+  }
+
+  NSData *data = [string dataUsingEncoding:NSUTF8StringEncoding];
   lwc_intern_string((const char *)data.bytes, data.length, &str);
   return str;
 }
 
+
+static lwc_string *_cachedIntern(NSString *string, NSUInteger hash) {
+  css_lwc_lock();
+  lwc_string *str = _cacheLookup(string, hash);
+  css_lwc_unlock();
+  if (!str) {
+    str = _intern(string);
+    if (str) {
+      css_lwc_lock();
+      _cacheInsert(string, hash, str);
+      css_lwc_unlock();
+    }
+  }
+  return str;
+}
+
+
+#pragma mark -
+
+static inline BOOL _isASCII(const char *bytes, size_t length) {
+  size_t i;
+  for (i = 0; i < length; i++) {
+    if (bytes[i] & 0x80) return NO;
+  }
+  return YES;
+}
+
+
+@implementation NSString (wapcaplet)
+
++ (NSString*)stringWithLWCString:(lwc_string*)str {
+  const char *bytes = lwc_string_data(str);
+  size_t length = lwc_string_length(str);
+  if (_isASCII(bytes, length))
+    return [[[CSSLWCString alloc] initWithLWCString:str] autorelease];
+  return [[[NSString alloc] initWithBytes:bytes
+                                   length:length
+                                 encoding:NSUTF8StringEncoding] autorelease];
+}
+
+- (lwc_string*)LWCString {
+  return _cachedIntern(self, [self hash]);
+}
+
+@end
+
+
+@implementation NSArray (wapcaplet)
+
+- (lwc_string**)LWCStringArray {
+  NSUInteger count = [self count];
+  NSUInteger i, missCount = 0;
+  if (count == 0) return NULL;
+  lwc_string **array = css_cf_realloc(NULL, count * sizeof(lwc_string*), 0);
+  if (!array) return NULL;
+
+  // hashes, followed by the indices, UTF-8 bytes, lengths and interned
+  // strings of those which missed the cache
+  size_t scratchSize = count * (2 * sizeof(NSUInteger) + sizeof(const char *) +
+                                sizeof(size_t) + sizeof(lwc_string *));
+  NSUInteger stackScratch[5 * 32];
+  NSUInteger *hashes = scratchSize <= sizeof(stackScratch) ? stackScratch
+      : css_cf_realloc(NULL, scratchSize, 0);
+  if (!hashes) {
+    css_cf_realloc(array, 0, 0);
+    return NULL;
+  }
+  NSUInteger *misses = hashes + count;
+  const char **missBytes = (const char **)(misses + count);
+  size_t *missLengths = (size_t *)(missBytes + count);
+  lwc_string **missStrings = (lwc_string **)(missLengths + count);
+
+  // hash outside of the lock, prefetching the cache slots to be probed
+  // (reading the table without the lock is fine for a prefetch)
+  Class bridgedClass = [CSSLWCString class];
+  lwc_cache_entry *entries = gLWCCache_.entries;
+  NSUInteger mask = gLWCCache_.size - 1;
+  for (i = 0; i < count; i++) {
+    NSString *string = [self objectAtIndex:i];
+    if ([string isKindOfClass:bridgedClass]) continue;
+    hashes[i] = [string hash];
+    if (entries) __builtin_prefetch(&entries[hashes[i] & mask]);
+  }
+
+  // look everything up under a single lock ...
+  css_lwc_lock();
+  for (i = 0; i < count; i++) {
+    NSString *string = [self objectAtIndex:i];
+    if ([string isKindOfClass:bridgedClass]) {
+      array[i] = [string LWCString];
+    } else if (!(array[i] = _cacheLookup(string, hashes[i]))) {
+      misses[missCount++] = i;
+    }
+  }
+  css_lwc_unlock();
+
+  // ... intern the misses in one go without it, and cache them under a
+  // single lock
+  for (i = 0; i < missCount; i++) {
+    NSString *string = [self objectAtIndex:misses[i]];
+    const char *bytes = CFStringGetCStringPtr((CFStringRef)string,
+                                              kCFStringEncodingUTF8);
+    if (!bytes) bytes = [string UTF8String];
+    missBytes[i] = bytes;
+    missLengths[i] = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+  }
+  if (css_lwc_intern_strings(missBytes, missLengths, missCount,
+                             missStrings) != lwc_error_ok) {
+    for (i = 0; i < count; i++) {
+      if (array[i]) lwc_string_unref(array[i]);
+    }
+    css_cf_realloc(array, 0, 0);
+    array = NULL;
+  } else if (missCount) {
+    css_lwc_lock();
+    for (i = 0; i < missCount; i++) {
+      NSUInteger index = misses[i];
+      array[index] = missStrings[i];
+      _cacheInsert([self objectAtIndex:index], hashes[index], array[index]);
+    }
+    css_lwc_unlock();
+  }
+
+  if (hashes != stackScratch) css_cf_realloc(hashes, 0, 0);
+  return array;
+}
+
 @end
@@ -1,5 +1,30 @@
 #import "NSURL-blocks.h"
 
+#import <pthread.h>
+
+// Thread running the run loop every connection is scheduled on, so that
+// fetches neither need the starting thread to run its run loop (the workers
+// of dispatch queues never do) nor the main thread to be free: a caller
+// waiting on the main thread for a sheet to load would otherwise never see
+// its @imports arrive.
+static NSThread *gNetworkThread_ = nil;
+static pthread_once_t gNetworkThreadOnce_ = PTHREAD_ONCE_INIT;
+
+@interface CSSURLConnection ()
++ (void)_runNetworkThread:(id)unused;
+- (void)_startOnNetworkThread;
+@end
+
+static void _startNetworkThread(void) {
+  gNetworkThread_ =
+      [[NSThread alloc] initWithTarget:[CSSURLConnection class]
+                              selector:@selector(_runNetworkThread:)
+                                object:nil];
+  [gNetworkThread_ setName:@"CSS.framework network"];
+  [gNetworkThread_ start];
+}
+
+
 @implementation CSSURLConnection
 
 - (id)initWithRequest:(NSURLRequest*)request
@@ -21,14 +46,38 @@
 }
 
 
-- (void)start {
-  // schedule in NSDefaultRunLoopMode to support multithreading
++ (void)_runNetworkThread:(id)unused {
+  NSAutoreleasePool *pool = [NSAutoreleasePool new];
+  // a run loop without any source returns right away
+  [[NSRunLoop currentRunLoop] addPort:[NSMachPort port]
+                              forMode:NSDefaultRunLoopMode];
+  [pool drain];
+  while (1) {
+    pool = [NSAutoreleasePool new];
+    [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode
+                             beforeDate:[NSDate distantFuture]];
+    [pool drain];
+  }
+}
+
+
+- (void)_startOnNetworkThread {
   [self scheduleInRunLoop:[NSRunLoop currentRunLoop]
                   forMode:NSDefaultRunLoopMode];
   [super start];
 }
 
 
+- (void)start {
+  // the blocks are invoked on the network thread (see gNetworkThread_)
+  pthread_once(&gNetworkThreadOnce_, &_startNetworkThread);
+  [self performSelector:@selector(_startOnNetworkThread)
+               onThread:gNetworkThread_
+             withObject:nil
+          waitUntilDone:NO];
+}
+
+
 - (void) dealloc {
   if (onResponse) { [onResponse release]; onResponse = nil; }
   if (onData) { [onData release]; onData = nil; }
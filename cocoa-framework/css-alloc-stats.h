@@ -0,0 +1,83 @@
+#ifndef CSS_ALLOC_STATS_H_
+#define CSS_ALLOC_STATS_H_
+
+/**
+ * Allocation accounting.
+ *
+ * css_tracking_realloc is a libcss allocator function which forwards to
+ * another allocator and attributes every allocation to an owner (|tag|),
+ * keeping live and peak bytes, call counts and a size histogram per owner.
+ * All of the framework's libcss allocators are wrapped this way, and the
+ * counters can be read from any thread with css_alloc_get_stats.
+ *
+ * A tracker can also enforce a memory budget: once the bytes live through
+ * it (or, if it has a |footprint| function, the bytes its allocator holds)
+ * would exceed |limit|, allocations fail and libcss reports CSS_NOMEM for
+ * the operation in progress.
+ *
+ * libcss frees some blocks it did not allocate with the tracker, e.g. the
+ * arrays returned by node_classes handlers. A tracker with an |owns|
+ * function passes such blocks through to its allocator without counting
+ * them, so that |used| only ever reflects its own blocks.
+ */
+
+typedef enum {
+  CSS_ALLOC_STYLESHEET = 0,   // stylesheet parsing (per-sheet arenas)
+  CSS_ALLOC_SELECTION,        // selection contexts
+  CSS_ALLOC_COMPUTED_STYLE,   // computed styles (the style pool)
+  CSS_ALLOC_STRINGS,          // the framework's intern cache tables
+  CSS_ALLOC_NUM_TAGS
+} css_alloc_tag;
+
+/// Histogram buckets: <= 16 bytes, <= 32, <= 64, ... <= 32k, larger
+#define CSS_ALLOC_HISTOGRAM_SIZE 13
+
+typedef struct {
+  uint64_t liveBytes;
+  uint64_t peakBytes;
+  uint64_t allocCalls;    // new blocks
+  uint64_t reallocCalls;  // resized blocks
+  uint64_t freeCalls;
+  uint64_t histogram[CSS_ALLOC_HISTOGRAM_SIZE];  // by requested size
+} css_alloc_stats;
+
+/// Returns the usable size of a block allocated by the wrapped allocator
+typedef size_t (*css_alloc_size_fn)(void *ptr, void *pw);
+
+/// Returns whether |ptr| was allocated by the wrapped allocator
+typedef bool (*css_alloc_owns_fn)(void *ptr, void *pw);
+
+/// Returns the number of bytes the wrapped allocator holds in total
+typedef size_t (*css_alloc_footprint_fn)(void *pw);
+
+typedef struct css_alloc_tracker {
+  css_allocator_fn alloc;  // wrapped allocator ...
+  void *pw;                // ... and its private data
+  css_alloc_size_fn size;  // block size function for |alloc|
+  css_alloc_owns_fn owns;  // NULL if every block freed comes from |alloc|
+  css_alloc_footprint_fn footprint;  // NULL to budget |used| bytes
+  css_alloc_tag tag;
+  size_t limit;               // budget in bytes, 0 for unlimited
+  volatile int64_t used;      // bytes currently live through this tracker
+  // Allocations refused because of |limit| since the tracker was created.
+  // It is never reset; compare it with a value read before an operation to
+  // tell whether that operation ran out of budget.
+  volatile int32_t limitHits;
+} css_alloc_tracker;
+
+/// Tracker for the computed style pool, shared by all styles
+extern css_alloc_tracker css_alloc_tracker_computed_style;
+
+/// Tracker for the tables of -[NSString LWCString]'s cache
+extern css_alloc_tracker css_alloc_tracker_strings;
+
+/// libcss allocator function. |pw| must be a css_alloc_tracker*.
+void *css_tracking_realloc(void *ptr, size_t size, void *pw);
+
+/// Take a snapshot of the counters for |tag|
+void css_alloc_get_stats(css_alloc_tag tag, css_alloc_stats *stats);
+
+/// Short name of |tag|, e.g. "stylesheet"
+const char *css_alloc_tag_name(css_alloc_tag tag);
+
+#endif  // CSS_ALLOC_STATS_H_
@@ -0,0 +1,109 @@
+#import "css-alloc-stats.h"
+#import "css-cf-realloc.h"
+#import "css-style-pool.h"
+#import <libkern/OSAtomic.h>
+
+typedef struct {
+  volatile int64_t liveBytes;
+  volatile int64_t peakBytes;
+  volatile int64_t allocCalls;
+  volatile int64_t reallocCalls;
+  volatile int64_t freeCalls;
+  volatile int64_t histogram[CSS_ALLOC_HISTOGRAM_SIZE];
+} css_alloc_counters;
+
+static css_alloc_counters gCounters_[CSS_ALLOC_NUM_TAGS];
+
+static const char *kTagNames[CSS_ALLOC_NUM_TAGS] = {
+  "stylesheet",
+  "selection",
+  "computed-style",
+  "strings",
+};
+
+css_alloc_tracker css_alloc_tracker_computed_style = {
+  &css_style_pool_realloc, NULL, &css_style_pool_block_size, NULL, NULL,
+  CSS_ALLOC_COMPUTED_STYLE, 0, 0, 0
+};
+
+css_alloc_tracker css_alloc_tracker_strings = {
+  &css_cf_realloc, NULL, &css_cf_block_size, NULL, NULL,
+  CSS_ALLOC_STRINGS, 0, 0, 0
+};
+
+
+static inline int _histogramBucket(size_t size) {
+  int bucket = 0;
+  size_t limit = 16;
+  while (size > limit && bucket < CSS_ALLOC_HISTOGRAM_SIZE - 1) {
+    limit <<= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+
+static inline void _addLiveBytes(css_alloc_counters *c, int64_t delta) {
+  int64_t live = OSAtomicAdd64(delta, &c->liveBytes);
+  int64_t peak;
+  while (live > (peak = c->peakBytes) &&
+         !OSAtomicCompareAndSwap64(peak, live, &c->peakBytes)) {}
+}
+
+
+void *css_tracking_realloc(void *ptr, size_t size, void *pw) {
+  css_alloc_tracker *tracker = (css_alloc_tracker*)pw;
+  css_alloc_counters *c = &gCounters_[tracker->tag];
+
+  if (ptr && tracker->owns && !tracker->owns(ptr, tracker->pw)) {
+    // not one of ours, so there is nothing to account for
+    return tracker->alloc(ptr, size, tracker->pw);
+  }
+
+  size_t oldSize = ptr ? tracker->size(ptr, tracker->pw) : 0;
+
+  if (tracker->limit && size > oldSize) {
+    int64_t current = tracker->footprint
+        ? (int64_t)tracker->footprint(tracker->pw) : tracker->used;
+    if (current + (int64_t)(size - oldSize) > (int64_t)tracker->limit) {
+      OSAtomicIncrement32(&tracker->limitHits);
+      return NULL;
+    }
+  }
+
+  void *newptr = tracker->alloc(ptr, size, tracker->pw);
+
+  if (size == 0) {
+    if (ptr) {
+      OSAtomicIncrement64(&c->freeCalls);
+      OSAtomicAdd64(-(int64_t)oldSize, &tracker->used);
+      _addLiveBytes(c, -(int64_t)oldSize);
+    }
+  } else if (newptr) {
+    int64_t delta = (int64_t)tracker->size(newptr, tracker->pw) -
+                    (int64_t)oldSize;
+    OSAtomicIncrement64(ptr ? &c->reallocCalls : &c->allocCalls);
+    OSAtomicIncrement64(&c->histogram[_histogramBucket(size)]);
+    OSAtomicAdd64(delta, &tracker->used);
+    _addLiveBytes(c, delta);
+  }
+  return newptr;
+}
+
+
+void css_alloc_get_stats(css_alloc_tag tag, css_alloc_stats *stats) {
+  css_alloc_counters *c = &gCounters_[tag];
+  int i;
+  stats->liveBytes = (uint64_t)c->liveBytes;
+  stats->peakBytes = (uint64_t)c->peakBytes;
+  stats->allocCalls = (uint64_t)c->allocCalls;
+  stats->reallocCalls = (uint64_t)c->reallocCalls;
+  stats->freeCalls = (uint64_t)c->freeCalls;
+  for (i = 0; i < CSS_ALLOC_HISTOGRAM_SIZE; i++)
+    stats->histogram[i] = (uint64_t)c->histogram[i];
+}
+
+
+const char *css_alloc_tag_name(css_alloc_tag tag) {
+  return tag < CSS_ALLOC_NUM_TAGS ? kTagNames[tag] : "unknown";
+}
@@ -0,0 +1,32 @@
+#ifndef CSS_ARENA_H_
+#define CSS_ARENA_H_
+
+/**
+ * Bump-pointer arena for objects which all die at the same time, e.g.
+ * everything libcss allocates for one stylesheet.
+ *
+ * Use css_arena_realloc as the allocator and the arena as its |pw|. Freeing
+ * or resizing the most recently allocated block happens in place, and
+ * freeing it also reclaims any freed blocks directly below it. Blocks too
+ * large for a chunk get a chunk of their own which is resized or returned
+ * to the system with the block. Other freed memory is reclaimed by
+ * css_arena_destroy. An arena is not thread-safe.
+ */
+typedef struct css_arena css_arena;
+
+/// Create an arena allocating |chunk_size| bytes at a time (0 for default)
+css_arena *css_arena_create(size_t chunk_size);
+
+/// Release all memory owned by |arena|
+void css_arena_destroy(css_arena *arena);
+
+/// libcss allocator function. |pw| must be a css_arena*.
+void *css_arena_realloc(void *ptr, size_t size, void *pw);
+
+/// Requested size of |ptr|, a block allocated from the arena |pw|
+size_t css_arena_block_size(void *ptr, void *pw);
+
+/// Number of bytes currently reserved from the system by |arena|
+size_t css_arena_size(const css_arena *arena);
+
+#endif  // CSS_ARENA_H_
@@ -0,0 +1,253 @@
+#import "css-arena.h"
+
+#define CSS_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+#define CSS_ARENA_ALIGN 16
+#define ALIGN_UP(n) (((n) + (CSS_ARENA_ALIGN - 1)) & ~(size_t)(CSS_ARENA_ALIGN-1))
+
+typedef struct css_arena_chunk {
+  struct css_arena_chunk *next;
+  struct css_arena_chunk *prev;
+  size_t capacity;  // bytes of block space following the header
+  size_t used;
+} css_arena_chunk;
+
+// every block is preceded by its requested size and by the offset of the
+// block below it in the same chunk, the low bits of which hold BLOCK_* flags
+typedef struct {
+  size_t size;
+  size_t info;
+} css_arena_block;
+
+#define BLOCK_FREE  1  // released, waiting for the blocks above it to go
+#define BLOCK_LARGE 2  // alone in a chunk of its own
+#define BLOCK_FIRST 4  // lowest block in its chunk
+#define BLOCK_PREV(info) ((info) & ~(size_t)(CSS_ARENA_ALIGN - 1))
+
+#define CHUNK_HEADER_SIZE ALIGN_UP(sizeof(css_arena_chunk))
+#define BLOCK_HEADER_SIZE ALIGN_UP(sizeof(css_arena_block))
+#define CHUNK_DATA(chunk) ((char*)(chunk) + CHUNK_HEADER_SIZE)
+#define BLOCK_OF(ptr) ((css_arena_block*)((char*)(ptr) - BLOCK_HEADER_SIZE))
+#define LARGE_CHUNK_OF(block) \
+    ((css_arena_chunk*)((char*)(block) - CHUNK_HEADER_SIZE))
+
+struct css_arena {
+  css_arena_chunk *chunk;  // chunk currently bumped into; head of the list
+  void *last;              // topmost block in |chunk|, or NULL if empty
+  size_t chunk_size;
+  size_t size;             // total bytes of all chunks
+};
+
+
+css_arena *css_arena_create(size_t chunk_size) {
+  css_arena *arena =
+      CFAllocatorAllocate(kCFAllocatorDefault, sizeof(css_arena), 0);
+  if (arena) {
+    arena->chunk = NULL;
+    arena->last = NULL;
+    arena->chunk_size = chunk_size ? chunk_size
+                                   : CSS_ARENA_DEFAULT_CHUNK_SIZE;
+    arena->size = 0;
+  }
+  return arena;
+}
+
+
+void css_arena_destroy(css_arena *arena) {
+  if (!arena) return;
+  css_arena_chunk *chunk = arena->chunk;
+  while (chunk) {
+    css_arena_chunk *next = chunk->next;
+    CFAllocatorDeallocate(kCFAllocatorDefault, chunk);
+    chunk = next;
+  }
+  CFAllocatorDeallocate(kCFAllocatorDefault, arena);
+}
+
+
+size_t css_arena_size(const css_arena *arena) {
+  return arena->size;
+}
+
+
+size_t css_arena_block_size(void *ptr, void *pw) { pw=pw;
+  return BLOCK_OF(ptr)->size;
+}
+
+
+static css_arena_chunk *_newChunk(css_arena *arena, size_t capacity) {
+  css_arena_chunk *chunk = CFAllocatorAllocate(kCFAllocatorDefault,
+      (CFIndex)(CHUNK_HEADER_SIZE + capacity), 0);
+  if (chunk) {
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    chunk->prev = NULL;
+    arena->size += CHUNK_HEADER_SIZE + capacity;
+  }
+  return chunk;
+}
+
+
+// Point the neighbours of |chunk| at |to|, which is either NULL (unlinking
+// the chunk) or the same chunk after it was moved by reallocation
+static void _relink(css_arena *arena, css_arena_chunk *chunk,
+                    css_arena_chunk *to) {
+  css_arena_chunk *next = to ? to->next : chunk->next;
+  css_arena_chunk *prev = to ? to->prev : chunk->prev;
+  if (prev)
+    prev->next = to ? to : next;
+  else
+    arena->chunk = to ? to : next;
+  if (next)
+    next->prev = to ? to : prev;
+}
+
+
+static void *_allocLarge(css_arena *arena, size_t size) {
+  // large blocks get a chunk of their own, linked in behind the current
+  // chunk so that we keep bumping into the latter
+  size_t need = BLOCK_HEADER_SIZE + ALIGN_UP(size);
+  css_arena_chunk *chunk = arena->chunk;
+  css_arena_chunk *large = _newChunk(arena, need);
+  if (!large) return NULL;
+  large->used = need;
+  if (chunk) {
+    large->next = chunk->next;
+    large->prev = chunk;
+    if (chunk->next)
+      chunk->next->prev = large;
+    chunk->next = large;
+  } else {
+    large->next = NULL;
+    arena->chunk = large;
+    arena->last = NULL;
+  }
+  css_arena_block *block = (css_arena_block*)CHUNK_DATA(large);
+  block->size = size;
+  block->info = BLOCK_LARGE | BLOCK_FIRST;
+  return (char*)block + BLOCK_HEADER_SIZE;
+}
+
+
+static void *_alloc(css_arena *arena, size_t size) {
+  size_t need = BLOCK_HEADER_SIZE + ALIGN_UP(size);
+  css_arena_chunk *chunk = arena->chunk;
+
+  if (need > arena->chunk_size / 4)
+    return _allocLarge(arena, size);
+
+  if (!chunk || chunk->capacity - chunk->used < need) {
+    chunk = _newChunk(arena, arena->chunk_size);
+    if (!chunk) return NULL;
+    chunk->next = arena->chunk;
+    if (arena->chunk)
+      arena->chunk->prev = chunk;
+    arena->chunk = chunk;
+    arena->last = NULL;
+  }
+
+  css_arena_block *block =
+      (css_arena_block*)(CHUNK_DATA(chunk) + chunk->used);
+  block->size = size;
+  block->info = arena->last
+      ? (size_t)((char*)BLOCK_OF(arena->last) - CHUNK_DATA(chunk))
+      : BLOCK_FIRST;
+  chunk->used += need;
+  arena->last = (char*)block + BLOCK_HEADER_SIZE;
+  return arena->last;
+}
+
+
+// Release the topmost block of the current chunk together with any freed
+// blocks directly below it, so that their space is bumped into again
+static void _popLast(css_arena *arena) {
+  css_arena_chunk *chunk = arena->chunk;
+  css_arena_block *block = BLOCK_OF(arena->last);
+  for (;;) {
+    chunk->used = (size_t)((char*)block - CHUNK_DATA(chunk));
+    if (block->info & BLOCK_FIRST) {
+      arena->last = NULL;
+      return;
+    }
+    block = (css_arena_block*)(CHUNK_DATA(chunk) + BLOCK_PREV(block->info));
+    if (!(block->info & BLOCK_FREE)) {
+      arena->last = (char*)block + BLOCK_HEADER_SIZE;
+      return;
+    }
+  }
+}
+
+
+static void *_reallocLarge(css_arena *arena, css_arena_block *block,
+                           size_t size) {
+  css_arena_chunk *chunk = LARGE_CHUNK_OF(block);
+  size_t capacity = chunk->capacity;
+
+  if (size == 0) {
+    _relink(arena, chunk, NULL);
+    arena->size -= CHUNK_HEADER_SIZE + capacity;
+    CFAllocatorDeallocate(kCFAllocatorDefault, chunk);
+    return NULL;
+  }
+
+  size_t need = BLOCK_HEADER_SIZE + ALIGN_UP(size);
+  if (need <= capacity) {
+    block->size = size;
+    return (char*)block + BLOCK_HEADER_SIZE;
+  }
+
+  css_arena_chunk *moved = CFAllocatorReallocate(kCFAllocatorDefault, chunk,
+      (CFIndex)(CHUNK_HEADER_SIZE + need), 0);
+  if (!moved) return NULL;
+  _relink(arena, chunk, moved);
+  moved->capacity = moved->used = need;
+  arena->size += need - capacity;
+  block = (css_arena_block*)CHUNK_DATA(moved);
+  block->size = size;
+  return (char*)block + BLOCK_HEADER_SIZE;
+}
+
+
+void *css_arena_realloc(void *ptr, size_t size, void *pw) {
+  css_arena *arena = (css_arena*)pw;
+
+  if (!ptr)
+    return size ? _alloc(arena, size) : NULL;
+
+  css_arena_block *block = BLOCK_OF(ptr);
+  css_arena_chunk *chunk = arena->chunk;
+
+  if (block->info & BLOCK_LARGE)
+    return _reallocLarge(arena, block, size);
+
+  if (ptr == arena->last) {
+    // the topmost block can be resized or released in place
+    if (size == 0) {
+      _popLast(arena);
+      return NULL;
+    }
+    size_t offset = (size_t)((char*)block - CHUNK_DATA(chunk));
+    size_t need = BLOCK_HEADER_SIZE + ALIGN_UP(size);
+    if (need <= chunk->capacity - offset) {
+      chunk->used = offset + need;
+      block->size = size;
+      return ptr;
+    }
+  } else if (size == 0) {
+    // reclaimed once every block above it is released, or when the arena
+    // is destroyed
+    block->info |= BLOCK_FREE;
+    return NULL;
+  } else if (size <= block->size) {
+    block->size = size;
+    return ptr;
+  }
+
+  size_t oldsize = block->size;
+  void *newptr = _alloc(arena, size);
+  if (newptr) {
+    memcpy(newptr, ptr, oldsize < size ? oldsize : size);
+    // |ptr| may since have stopped being the topmost block
+    css_arena_realloc(ptr, 0, arena);
+  }
+  return newptr;
+}
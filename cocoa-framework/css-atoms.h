@@ -0,0 +1,199 @@
+// Generated by tools/gen-atoms from tools/atoms.txt. Do not edit.
+#ifndef CSS_ATOMS_H_
+#define CSS_ATOMS_H_
+
+#include <stddef.h>
+#include <libwapcaplet/libwapcaplet.h>
+
+/**
+ * Strings interned once when the framework is loaded, for handlers
+ * which would otherwise intern the same element and attribute names
+ * over and over again: CSS_ATOM(div) is the lwc_string "div".
+ * Atoms live for the lifetime of the process, so they can be
+ * returned from handlers with just lwc_string_ref and compared by
+ * pointer with other interned strings.
+ */
+
+enum {
+  CSS_ATOM_EMPTY,  // ""
+  CSS_ATOM_a,
+  CSS_ATOM_abbr,
+  CSS_ATOM_acronym,
+  CSS_ATOM_address,
+  CSS_ATOM_applet,
+  CSS_ATOM_area,
+  CSS_ATOM_article,
+  CSS_ATOM_aside,
+  CSS_ATOM_audio,
+  CSS_ATOM_b,
+  CSS_ATOM_base,
+  CSS_ATOM_basefont,
+  CSS_ATOM_bdi,
+  CSS_ATOM_bdo,
+  CSS_ATOM_big,
+  CSS_ATOM_blockquote,
+  CSS_ATOM_body,
+  CSS_ATOM_br,
+  CSS_ATOM_button,
+  CSS_ATOM_canvas,
+  CSS_ATOM_caption,
+  CSS_ATOM_center,
+  CSS_ATOM_cite,
+  CSS_ATOM_code,
+  CSS_ATOM_col,
+  CSS_ATOM_colgroup,
+  CSS_ATOM_data,
+  CSS_ATOM_datalist,
+  CSS_ATOM_dd,
+  CSS_ATOM_del,
+  CSS_ATOM_details,
+  CSS_ATOM_dfn,
+  CSS_ATOM_dialog,
+  CSS_ATOM_dir,
+  CSS_ATOM_div,
+  CSS_ATOM_dl,
+  CSS_ATOM_dt,
+  CSS_ATOM_em,
+  CSS_ATOM_embed,
+  CSS_ATOM_fieldset,
+  CSS_ATOM_figcaption,
+  CSS_ATOM_figure,
+  CSS_ATOM_font,
+  CSS_ATOM_footer,
+  CSS_ATOM_form,
+  CSS_ATOM_frame,
+  CSS_ATOM_frameset,
+  CSS_ATOM_h1,
+  CSS_ATOM_h2,
+  CSS_ATOM_h3,
+  CSS_ATOM_h4,
+  CSS_ATOM_h5,
+  CSS_ATOM_h6,
+  CSS_ATOM_head,
+  CSS_ATOM_header,
+  CSS_ATOM_hgroup,
+  CSS_ATOM_hr,
+  CSS_ATOM_html,
+  CSS_ATOM_i,
+  CSS_ATOM_iframe,
+  CSS_ATOM_img,
+  CSS_ATOM_input,
+  CSS_ATOM_ins,
+  CSS_ATOM_kbd,
+  CSS_ATOM_label,
+  CSS_ATOM_legend,
+  CSS_ATOM_li,
+  CSS_ATOM_link,
+  CSS_ATOM_main,
+  CSS_ATOM_map,
+  CSS_ATOM_mark,
+  CSS_ATOM_menu,
+  CSS_ATOM_meta,
+  CSS_ATOM_meter,
+  CSS_ATOM_nav,
+  CSS_ATOM_noframes,
+  CSS_ATOM_noscript,
+  CSS_ATOM_object,
+  CSS_ATOM_ol,
+  CSS_ATOM_optgroup,
+  CSS_ATOM_option,
+  CSS_ATOM_output,
+  CSS_ATOM_p,
+  CSS_ATOM_param,
+  CSS_ATOM_picture,
+  CSS_ATOM_pre,
+  CSS_ATOM_progress,
+  CSS_ATOM_q,
+  CSS_ATOM_rp,
+  CSS_ATOM_rt,
+  CSS_ATOM_ruby,
+  CSS_ATOM_s,
+  CSS_ATOM_samp,
+  CSS_ATOM_script,
+  CSS_ATOM_section,
+  CSS_ATOM_select,
+  CSS_ATOM_small,
+  CSS_ATOM_source,
+  CSS_ATOM_span,
+  CSS_ATOM_strike,
+  CSS_ATOM_strong,
+  CSS_ATOM_style,
+  CSS_ATOM_sub,
+  CSS_ATOM_summary,
+  CSS_ATOM_sup,
+  CSS_ATOM_svg,
+  CSS_ATOM_table,
+  CSS_ATOM_tbody,
+  CSS_ATOM_td,
+  CSS_ATOM_template,
+  CSS_ATOM_textarea,
+  CSS_ATOM_tfoot,
+  CSS_ATOM_th,
+  CSS_ATOM_thead,
+  CSS_ATOM_time,
+  CSS_ATOM_title,
+  CSS_ATOM_tr,
+  CSS_ATOM_track,
+  CSS_ATOM_tt,
+  CSS_ATOM_u,
+  CSS_ATOM_ul,
+  CSS_ATOM_var,
+  CSS_ATOM_video,
+  CSS_ATOM_wbr,
+  CSS_ATOM_accept,
+  CSS_ATOM_accept_charset,
+  CSS_ATOM_accesskey,
+  CSS_ATOM_action,
+  CSS_ATOM_align,
+  CSS_ATOM_alt,
+  CSS_ATOM_background,
+  CSS_ATOM_bgcolor,
+  CSS_ATOM_border,
+  CSS_ATOM_cellpadding,
+  CSS_ATOM_cellspacing,
+  CSS_ATOM_charset,
+  CSS_ATOM_checked,
+  CSS_ATOM_class,
+  CSS_ATOM_color,
+  CSS_ATOM_cols,
+  CSS_ATOM_colspan,
+  CSS_ATOM_content,
+  CSS_ATOM_disabled,
+  CSS_ATOM_for,
+  CSS_ATOM_height,
+  CSS_ATOM_href,
+  CSS_ATOM_hreflang,
+  CSS_ATOM_http_equiv,
+  CSS_ATOM_id,
+  CSS_ATOM_lang,
+  CSS_ATOM_media,
+  CSS_ATOM_method,
+  CSS_ATOM_multiple,
+  CSS_ATOM_name,
+  CSS_ATOM_placeholder,
+  CSS_ATOM_readonly,
+  CSS_ATOM_rel,
+  CSS_ATOM_rev,
+  CSS_ATOM_role,
+  CSS_ATOM_rows,
+  CSS_ATOM_rowspan,
+  CSS_ATOM_selected,
+  CSS_ATOM_size,
+  CSS_ATOM_src,
+  CSS_ATOM_tabindex,
+  CSS_ATOM_target,
+  CSS_ATOM_type,
+  CSS_ATOM_valign,
+  CSS_ATOM_value,
+  CSS_ATOM_width,
+  CSS_ATOM_COUNT
+};
+
+extern lwc_string *css_atoms[CSS_ATOM_COUNT];
+
+#define CSS_ATOM(name) (css_atoms[CSS_ATOM_##name])
+
+/// Index of the atom with the given bytes, or -1 if there is none
+int css_atom_lookup(const char *data, size_t length);
+
+#endif  // CSS_ATOMS_H_
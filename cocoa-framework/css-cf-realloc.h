@@ -4,4 +4,21 @@
 /// cf-aware memory allocator which uses the cf memory pool.
 void *css_cf_realloc(void *ptr, size_t size, void *pw);
 
+/// Usable size of a block returned by css_cf_realloc
+size_t css_cf_block_size(void *ptr, void *pw);
+
+/**
+ * Allocator for the framework's own blocks, backed by a private malloc zone
+ * so that css_zone_owns can tell them apart from blocks allocated elsewhere
+ * (e.g. with css_cf_realloc). Freeing or resizing a block of another zone
+ * is passed on to that zone. |pw| is ignored.
+ */
+void *css_zone_realloc(void *ptr, size_t size, void *pw);
+
+/// Usable size of a block returned by css_zone_realloc
+size_t css_zone_block_size(void *ptr, void *pw);
+
+/// Whether |ptr| was allocated by css_zone_realloc
+bool css_zone_owns(void *ptr, void *pw);
+
 #endif  // CSS_CF_REALLOC_H_
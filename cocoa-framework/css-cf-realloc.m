@@ -1,4 +1,14 @@
 #import "css-cf-realloc.h"
+#import <malloc/malloc.h>
+#import <pthread.h>
+
+static malloc_zone_t *gZone_ = NULL;
+static pthread_once_t gZoneOnce_ = PTHREAD_ONCE_INIT;
+
+static void _createZone() {
+  gZone_ = malloc_create_zone(0, 0);
+  malloc_set_zone_name(gZone_, "CSS.framework");
+}
 
 void *css_cf_realloc(void *ptr, size_t size, void *pw) { pw=pw;
   if (size)
@@ -6,3 +16,30 @@ void *css_cf_realloc(void *ptr, size_t size, void *pw) { pw=pw;
   CFAllocatorDeallocate(kCFAllocatorDefault, ptr);
   return NULL;
 }
+
+// the default CF allocator is backed by the default malloc zone
+size_t css_cf_block_size(void *ptr, void *pw) { pw=pw;
+  return malloc_size(ptr);
+}
+
+
+void *css_zone_realloc(void *ptr, size_t size, void *pw) { pw=pw;
+  pthread_once(&gZoneOnce_, &_createZone);
+  malloc_zone_t *zone = ptr ? malloc_zone_from_ptr(ptr) : gZone_;
+  if (!zone) zone = gZone_;
+  if (size)
+    return malloc_zone_realloc(zone, ptr, size);
+  malloc_zone_free(zone, ptr);
+  return NULL;
+}
+
+
+size_t css_zone_block_size(void *ptr, void *pw) { pw=pw;
+  return malloc_size(ptr);
+}
+
+
+bool css_zone_owns(void *ptr, void *pw) { pw=pw;
+  pthread_once(&gZoneOnce_, &_createZone);
+  return malloc_zone_from_ptr(ptr) == gZone_;
+}
@@ -0,0 +1,23 @@
+#ifndef CSS_FILE_MAP_H_
+#define CSS_FILE_MAP_H_
+
+/**
+ * Read-only memory mapping of a whole file. An empty file maps to NULL
+ * bytes of zero length.
+ */
+typedef struct {
+  const void *bytes;
+  size_t length;
+} css_file_map;
+
+/// Map the file at |path|. Returns 0 on success, an errno value otherwise.
+int css_file_map_open(const char *path, css_file_map *map);
+
+/// Tell the kernel |map| will be read once from start to end, so it can read
+/// ahead aggressively and drop pages behind the reader
+void css_file_map_sequential(const css_file_map *map);
+
+/// Unmap a file mapped by css_file_map_open
+void css_file_map_close(css_file_map *map);
+
+#endif  // CSS_FILE_MAP_H_
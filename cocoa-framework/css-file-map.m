@@ -0,0 +1,50 @@
+#import "css-file-map.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <stdint.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+
+int css_file_map_open(const char *path, css_file_map *map) {
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  map->bytes = NULL;
+  map->length = 0;
+  if (fd == -1) return errno;
+  if (fstat(fd, &st) == -1) {
+    int err = errno;
+    close(fd);
+    return err;
+  }
+  if ((uint64_t)st.st_size > SIZE_MAX) {
+    close(fd);
+    return EFBIG;
+  }
+  if (st.st_size > 0) {
+    void *bytes = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (bytes == MAP_FAILED) {
+      int err = errno;
+      close(fd);
+      return err;
+    }
+    map->bytes = bytes;
+    map->length = (size_t)st.st_size;
+  }
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+  return 0;
+}
+
+
+void css_file_map_sequential(const css_file_map *map) {
+  if (map->bytes) madvise((void*)map->bytes, map->length, MADV_SEQUENTIAL);
+}
+
+
+void css_file_map_close(css_file_map *map) {
+  if (map->bytes) munmap((void*)map->bytes, map->length);
+  map->bytes = NULL;
+  map->length = 0;
+}
@@ -0,0 +1,29 @@
+#ifndef CSS_LWC_CASELESS_H_
+#define CSS_LWC_CASELESS_H_
+
+/**
+ * Fast ASCII-caseless equality for interned strings, a drop-in replacement
+ * for lwc_string_caseless_isequal in selection handlers (node_has_name,
+ * named_ancestor_node, ...).
+ *
+ * css_lwc_caseless_compare folds and compares 16 (SSE2) or 8 bytes at a
+ * time instead of byte by byte. css_lwc_caseless_isequal compares the
+ * interned lowercase twins of the strings, which libwapcaplet creates on
+ * first use and keeps with each string (patches/libwapcaplet/
+ * 05-caseless-twin.patch), so after that it is a pointer comparison.
+ */
+
+/// Compare the bytes of |a| and |b|, ignoring ASCII case
+bool css_lwc_caseless_compare(lwc_string *a, lwc_string *b);
+
+/// Like css_lwc_caseless_compare, using and maintaining lowercase twins
+bool css_lwc_caseless_isequal(lwc_string *a, lwc_string *b);
+
+/**
+ * Interned lowercase twin of |str| (possibly |str| itself), or NULL if it
+ * can not be created. The returned string is not referenced and lives as
+ * long as |str|.
+ */
+lwc_string *css_lwc_lowercase(lwc_string *str);
+
+#endif  // CSS_LWC_CASELESS_H_
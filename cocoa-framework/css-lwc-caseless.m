@@ -0,0 +1,84 @@
+#import <libwapcaplet/libwapcaplet.h>
+#import "css-lwc-caseless.h"
+#import <stdlib.h>
+#import <string.h>
+#ifdef __SSE2__
+#import <emmintrin.h>
+#endif
+
+// --------------------------------------------------------------------------
+// Comparison
+
+// Lowercase the ASCII letters in 8 bytes at once. A byte is an uppercase
+// letter if it is ASCII and adding 0x3f (reaching 'A' + 0x3f = 0x80) sets
+// bit 7 but adding 0x25 ('Z' + 0x25 = 0x7f) does not.
+static inline uint64_t _fold8(uint64_t x) {
+  uint64_t heptets = x & 0x7f7f7f7f7f7f7f7fULL;
+  uint64_t aboveZ = heptets + 0x2525252525252525ULL;
+  uint64_t atLeastA = heptets + 0x3f3f3f3f3f3f3f3fULL;
+  uint64_t upper = ~x & (atLeastA ^ aboveZ) & 0x8080808080808080ULL;
+  return x | (upper >> 2);
+}
+
+
+static inline uint64_t _load8(const char *p, size_t n) {
+  uint64_t x = 0;
+  memcpy(&x, p, n);
+  return x;
+}
+
+
+bool css_lwc_caseless_compare(lwc_string *a, lwc_string *b) {
+  if (a == b) return true;
+  size_t length = lwc_string_length(a);
+  if (length != lwc_string_length(b)) return false;
+  const char *pa = lwc_string_data(a);
+  const char *pb = lwc_string_data(b);
+
+#ifdef __SSE2__
+  const __m128i belowA = _mm_set1_epi8('A' - 1);
+  const __m128i aboveZ = _mm_set1_epi8('Z' + 1);
+  const __m128i bit5 = _mm_set1_epi8(0x20);
+  while (length >= 16) {
+    __m128i xa = _mm_loadu_si128((const __m128i*)pa);
+    __m128i xb = _mm_loadu_si128((const __m128i*)pb);
+    // bytes >= 0x80 are negative and never in 'A'..'Z'
+    __m128i ua = _mm_and_si128(_mm_cmpgt_epi8(xa, belowA),
+                               _mm_cmplt_epi8(xa, aboveZ));
+    __m128i ub = _mm_and_si128(_mm_cmpgt_epi8(xb, belowA),
+                               _mm_cmplt_epi8(xb, aboveZ));
+    xa = _mm_or_si128(xa, _mm_and_si128(ua, bit5));
+    xb = _mm_or_si128(xb, _mm_and_si128(ub, bit5));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(xa, xb)) != 0xffff)
+      return false;
+    pa += 16; pb += 16; length -= 16;
+  }
+#endif
+
+  while (length >= 8) {
+    if (_fold8(_load8(pa, 8)) != _fold8(_load8(pb, 8)))
+      return false;
+    pa += 8; pb += 8; length -= 8;
+  }
+  return length == 0 ||
+         _fold8(_load8(pa, length)) == _fold8(_load8(pb, length));
+}
+
+
+// --------------------------------------------------------------------------
+// Lowercase twins
+
+lwc_string *css_lwc_lowercase(lwc_string *str) {
+  lwc_string *lower = NULL;
+  if (lwc_string_caseless_twin(str, &lower) != lwc_error_ok) return NULL;
+  return lower;
+}
+
+
+bool css_lwc_caseless_isequal(lwc_string *a, lwc_string *b) {
+  if (a == b) return true;
+  lwc_string *la = css_lwc_lowercase(a);
+  lwc_string *lb = css_lwc_lowercase(b);
+  if (la && lb) return la == lb;
+  return css_lwc_caseless_compare(a, b);
+}
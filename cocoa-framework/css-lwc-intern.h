@@ -0,0 +1,23 @@
+#ifndef CSS_LWC_INTERN_H_
+#define CSS_LWC_INTERN_H_
+
+/**
+ * Intern |count| strings in one go: |strings[i]| of |lengths[i]| bytes is
+ * stored as a new reference in |out[i]|. Atoms (see css-atoms.h) are
+ * returned without hashing; the other strings are interned with a single
+ * lwc_intern_strings call. On failure no references are left in |out|.
+ */
+lwc_error css_lwc_intern_strings(const char * const *strings,
+                                 const size_t *lengths, size_t count,
+                                 lwc_string **out);
+
+/**
+ * Like css_lwc_intern_strings, but returns a new css_cf_realloc'd array,
+ * which is what libcss expects from a node_classes handler (it unrefs the
+ * strings and frees the array with the selection context's allocator).
+ * Returns NULL if |count| is 0 or on failure.
+ */
+lwc_string **css_lwc_intern_array(const char * const *strings,
+                                  const size_t *lengths, size_t count);
+
+#endif  // CSS_LWC_INTERN_H_
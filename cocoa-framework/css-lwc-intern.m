@@ -0,0 +1,65 @@
+#import <libwapcaplet/libwapcaplet.h>
+#import "css-lwc-intern.h"
+#import "css-atoms.h"
+#import "css-cf-realloc.h"
+
+
+lwc_error css_lwc_intern_strings(const char * const *strings,
+                                 const size_t *lengths, size_t count,
+                                 lwc_string **out) {
+  // atoms are referenced right away, everything else goes to libwapcaplet
+  // in a single lwc_intern_strings call
+  size_t i, rest = 0;
+  for (i = 0; i < count; i++) {
+    int atom = css_atom_lookup(strings[i], lengths[i]);
+    out[i] = atom >= 0 ? lwc_string_ref(css_atoms[atom]) : NULL;
+    if (atom < 0) rest++;
+  }
+  if (rest == count) return lwc_intern_strings(strings, lengths, count, out);
+  if (rest == 0) return lwc_error_ok;
+
+  // indices, bytes, lengths and interned strings of the non-atoms
+  size_t scratchSize = rest * (sizeof(size_t) + sizeof(const char *) +
+                               sizeof(size_t) + sizeof(lwc_string *));
+  size_t stackScratch[4 * 32];
+  size_t *indices = scratchSize <= sizeof(stackScratch) ? stackScratch
+      : css_cf_realloc(NULL, scratchSize, 0);
+  lwc_error error = lwc_error_oom;
+  if (indices) {
+    const char **restStrings = (const char **)(indices + rest);
+    size_t *restLengths = (size_t *)(restStrings + rest);
+    lwc_string **restOut = (lwc_string **)(restLengths + rest);
+    size_t j = 0;
+    for (i = 0; i < count; i++) {
+      if (out[i]) continue;
+      indices[j] = i;
+      restStrings[j] = strings[i];
+      restLengths[j++] = lengths[i];
+    }
+    error = lwc_intern_strings(restStrings, restLengths, rest, restOut);
+    if (error == lwc_error_ok) {
+      for (j = 0; j < rest; j++) out[indices[j]] = restOut[j];
+    }
+    if (indices != stackScratch) css_cf_realloc(indices, 0, 0);
+  }
+  if (error != lwc_error_ok) {
+    for (i = 0; i < count; i++) {
+      if (out[i]) lwc_string_unref(out[i]);
+    }
+  }
+  return error;
+}
+
+
+lwc_string **css_lwc_intern_array(const char * const *strings,
+                                  const size_t *lengths, size_t count) {
+  if (count == 0) return NULL;
+  lwc_string **array = css_cf_realloc(NULL, count * sizeof(lwc_string*), 0);
+  if (array &&
+      css_lwc_intern_strings(strings, lengths, count, array) !=
+      lwc_error_ok) {
+    css_cf_realloc(array, 0, 0);
+    array = NULL;
+  }
+  return array;
+}
@@ -0,0 +1,19 @@
+#ifndef CSS_LWC_LOCK_H_
+#define CSS_LWC_LOCK_H_
+
+/**
+ * libwapcaplet (as patched by patches/libwapcaplet) and libcss may be called
+ * from several threads at once, so different CSSStylesheet, CSSContext and
+ * CSSStyle objects can be used on different threads at the same time
+ * without any global lock.
+ *
+ * This lock only guards the framework's own intern table, the cache behind
+ * -[NSString LWCString]. It is
+ * held for table lookups and insertions (and the lwc_string references they
+ * take or drop), never while libcss runs or while a string is interned.
+ */
+
+void css_lwc_lock(void);
+void css_lwc_unlock(void);
+
+#endif  // CSS_LWC_LOCK_H_
@@ -0,0 +1,14 @@
+#import "css-lwc-lock.h"
+#import <pthread.h>
+
+static pthread_mutex_t gLock_ = PTHREAD_MUTEX_INITIALIZER;
+
+
+void css_lwc_lock(void) {
+  pthread_mutex_lock(&gLock_);
+}
+
+
+void css_lwc_unlock(void) {
+  pthread_mutex_unlock(&gLock_);
+}
@@ -0,0 +1,35 @@
+#ifndef CSS_STYLE_POOL_H_
+#define CSS_STYLE_POOL_H_
+
+/**
+ * Thread-safe size-class pool for computed styles.
+ *
+ * css_computed_style objects and their sub-blocks come in a handful of fixed
+ * sizes and are created and destroyed for every selection, so instead of
+ * going to the system allocator every time, freed blocks are kept on
+ * lock-free per-size-class free lists and handed out again. Pass
+ * css_style_pool_realloc (with any |pw|) to css_computed_style_create.
+ */
+
+typedef struct {
+  uint64_t allocations;  // blocks handed out
+  uint64_t reuses;       // ... of which were taken from a free list
+  uint64_t releases;     // blocks given back
+  uint64_t oversized;    // allocations too large to be pooled
+  uint64_t cached;       // blocks currently sitting on free lists
+  uint64_t cachedBytes;  // ... and their total size
+} css_style_pool_stats;
+
+/// libcss allocator function drawing from the pool
+void *css_style_pool_realloc(void *ptr, size_t size, void *pw);
+
+/// Usable size of a block allocated from the pool
+size_t css_style_pool_block_size(void *ptr, void *pw);
+
+/// Take a snapshot of the pool counters
+void css_style_pool_get_stats(css_style_pool_stats *stats);
+
+/// Return all cached blocks to the system allocator
+void css_style_pool_drain(void);
+
+#endif  // CSS_STYLE_POOL_H_
@@ -0,0 +1,149 @@
+#import "css-style-pool.h"
+#import <libkern/OSAtomic.h>
+
+// Size classes cover css_computed_style and its uncommon/page/aural blocks
+// and string lists with little internal waste. Anything bigger is oversized.
+static const uint32_t kSizeClasses[] = {
+  16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024
+};
+#define NUM_SIZE_CLASSES (sizeof(kSizeClasses) / sizeof(kSizeClasses[0]))
+#define OVERSIZED NUM_SIZE_CLASSES
+
+// upper bound on blocks cached per size class
+#define MAX_CACHED_PER_CLASS 8192
+
+// Precedes every block. The free list link lives in the (unused) payload of
+// free blocks, so the header is untouched while a block is cached.
+typedef union {
+  struct {
+    uint32_t sizeClass;  // index into kSizeClasses, or OVERSIZED
+    uint32_t size;       // requested size (oversized blocks only)
+  } info;
+  char align[16];
+} pool_header;
+
+#define HEADER_OF(ptr) ((pool_header*)((char*)(ptr) - sizeof(pool_header)))
+#define PAYLOAD_OF(header) ((void*)((char*)(header) + sizeof(pool_header)))
+
+static OSQueueHead gFreeLists_[NUM_SIZE_CLASSES];
+static volatile int32_t gCachedCount_[NUM_SIZE_CLASSES];
+
+static volatile int64_t gAllocations_ = 0;
+static volatile int64_t gReuses_ = 0;
+static volatile int64_t gReleases_ = 0;
+static volatile int64_t gOversized_ = 0;
+
+
+static inline uint32_t _sizeClassFor(size_t size) {
+  uint32_t i;
+  for (i = 0; i < NUM_SIZE_CLASSES; i++) {
+    if (size <= kSizeClasses[i])
+      return i;
+  }
+  return OVERSIZED;
+}
+
+
+static void *_alloc(size_t size) {
+  uint32_t sizeClass = _sizeClassFor(size);
+  pool_header *header = NULL;
+
+  OSAtomicIncrement64(&gAllocations_);
+  if (sizeClass == OVERSIZED) {
+    OSAtomicIncrement64(&gOversized_);
+    header = CFAllocatorAllocate(kCFAllocatorDefault,
+                                 (CFIndex)(sizeof(pool_header) + size), 0);
+    if (!header) return NULL;
+    header->info.size = (uint32_t)size;
+  } else {
+    header = OSAtomicDequeue(&gFreeLists_[sizeClass], sizeof(pool_header));
+    if (header) {
+      OSAtomicDecrement32(&gCachedCount_[sizeClass]);
+      OSAtomicIncrement64(&gReuses_);
+    } else {
+      header = CFAllocatorAllocate(kCFAllocatorDefault,
+          (CFIndex)(sizeof(pool_header) + kSizeClasses[sizeClass]), 0);
+      if (!header) return NULL;
+    }
+  }
+  header->info.sizeClass = sizeClass;
+  return PAYLOAD_OF(header);
+}
+
+
+static void _free(void *ptr) {
+  pool_header *header = HEADER_OF(ptr);
+  uint32_t sizeClass = header->info.sizeClass;
+
+  OSAtomicIncrement64(&gReleases_);
+  if (sizeClass == OVERSIZED ||
+      OSAtomicIncrement32(&gCachedCount_[sizeClass]) > MAX_CACHED_PER_CLASS) {
+    if (sizeClass != OVERSIZED)
+      OSAtomicDecrement32(&gCachedCount_[sizeClass]);
+    CFAllocatorDeallocate(kCFAllocatorDefault, header);
+  } else {
+    OSAtomicEnqueue(&gFreeLists_[sizeClass], header, sizeof(pool_header));
+  }
+}
+
+
+static inline size_t _capacityOf(void *ptr) {
+  pool_header *header = HEADER_OF(ptr);
+  if (header->info.sizeClass == OVERSIZED)
+    return header->info.size;
+  return kSizeClasses[header->info.sizeClass];
+}
+
+
+size_t css_style_pool_block_size(void *ptr, void *pw) { pw=pw;
+  return _capacityOf(ptr);
+}
+
+
+void *css_style_pool_realloc(void *ptr, size_t size, void *pw) { pw=pw;
+  if (!ptr)
+    return size ? _alloc(size) : NULL;
+  if (!size) {
+    _free(ptr);
+    return NULL;
+  }
+  size_t capacity = _capacityOf(ptr);
+  if (size <= capacity && HEADER_OF(ptr)->info.sizeClass != OVERSIZED)
+    return ptr;
+  void *newptr = _alloc(size);
+  if (newptr) {
+    memcpy(newptr, ptr, capacity < size ? capacity : size);
+    _free(ptr);
+  }
+  return newptr;
+}
+
+
+void css_style_pool_get_stats(css_style_pool_stats *stats) {
+  uint32_t i;
+  stats->allocations = (uint64_t)gAllocations_;
+  stats->reuses = (uint64_t)gReuses_;
+  stats->releases = (uint64_t)gReleases_;
+  stats->oversized = (uint64_t)gOversized_;
+  stats->cached = 0;
+  stats->cachedBytes = 0;
+  for (i = 0; i < NUM_SIZE_CLASSES; i++) {
+    int32_t count = gCachedCount_[i];
+    if (count > 0) {
+      stats->cached += (uint64_t)count;
+      stats->cachedBytes += (uint64_t)count * kSizeClasses[i];
+    }
+  }
+}
+
+
+void css_style_pool_drain(void) {
+  uint32_t i;
+  for (i = 0; i < NUM_SIZE_CLASSES; i++) {
+    pool_header *header;
+    while ((header = OSAtomicDequeue(&gFreeLists_[i], sizeof(pool_header)))) {
+      OSAtomicDecrement32(&gCachedCount_[i]);
+      CFAllocatorDeallocate(kCFAllocatorDefault, header);
+    }
+  }
+}
@@ -10,7 +10,7 @@ css_error node_name(void *pw, void *n, lwc_string **name) {
 }
 css_error node_has_name(void *pw, void *n, lwc_string *name, bool *match) {
 	lwc_string *node = n;
-	assert(lwc_string_caseless_isequal(node, name, match) == lwc_error_ok);
+	*match = css_lwc_caseless_isequal(node, name);
 	return CSS_OK;
 }
 
@@ -30,7 +30,10 @@ css_error node_has_name(void *pw, void *n, lwc_string *name, bool *match) {
   
   NSURL *url = [NSURL fileURLWithPath:@"/foo/bar/test.css"];
   CSSStylesheet *stylesheet = [[CSSStylesheet alloc] initWithURL:url];
-  [stylesheet loadData:data withCallback:^(NSError *err) {
+  // parse in the background, keeping the UI responsive for large sheets
+  [stylesheet loadData:data
+         callbackQueue:dispatch_get_main_queue()
+          withCallback:^(NSError *err) {
     if (err) {
       NSLog(@"parse: error: %@", err);
       [NSApp presentError:err];
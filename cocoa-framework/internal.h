@@ -12,7 +12,25 @@
 BOOL CSSCheck(css_error status);
 NSException *CSSCheck2(css_error status);
 
+/**
+ * NSError for |status|, telling budget overruns of |tracker| apart: a
+ * CSS_NOMEM is reported as such if tracker->limitHits has grown past
+ * |limitHits|, its value before the failed operation. Stylesheets are
+ * discarded after their first overrun and pass 0.
+ */
+NSError *CSSErrorFromStatus(css_error status,
+                            const struct css_alloc_tracker *tracker,
+                            int32_t limitHits);
+
 #import "css-cf-realloc.h"
+#import "css-arena.h"
+#import "css-style-pool.h"
+#import "css-alloc-stats.h"
+#import "css-lwc-lock.h"
+#import "css-lwc-caseless.h"
+#import "css-atoms.h"
+#import "css-lwc-intern.h"
+#import "css-file-map.h"
 #import "h-objc.h"
 #import "NSString-wapcaplet.h"
 #import "NSError-css.h"
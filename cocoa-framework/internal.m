@@ -13,13 +13,24 @@ NSException *CSSCheck2(css_error status) {
       return MAKE_EXC(NSRangeException, @"CSS.framework: %s",
                       css_error_to_string(status));
     } else if (status == CSS_NOMEM) {
-      NSLog(@"[CSS.framework] FATAL: out of memory -- softly terminating");
-      exit(1);
+      // most likely a memory budget was exceeded; the operation failed but
+      // everything else is intact
+      return MAKE_EXC(NSMallocException, @"CSS.framework: %s",
+                      css_error_to_string(status));
     }
   }
   return nil;
 }
 
+NSError *CSSErrorFromStatus(css_error status,
+                            const css_alloc_tracker *tracker,
+                            int32_t limitHits) {
+  if (status == CSS_NOMEM && tracker && tracker->limit &&
+      tracker->limitHits != limitHits)
+    return [NSError libcssMemoryLimitErrorWithLimit:tracker->limit];
+  return [NSError libcssErrorFromStatus:status];
+}
+
 BOOL CSSCheck(css_error status) {
   NSException *e = CSSCheck2(status);
   if (e) {
@@ -1,4 +1,4 @@
 #!/bin/bash
 cd "$(dirname "$0")"
 echo "Resetting/cleaning..."
-rm -rf libparserutils libwapcaplet libcss lib include
+rm -rf libparserutils libwapcaplet libcss lib include tools/build pgo-data
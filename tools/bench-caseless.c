@@ -0,0 +1,133 @@
+/*
+ * Caseless comparison of interned strings, as done by selection handlers in
+ * node_has_name, named_ancestor_node and friends. Compares libwapcaplet's
+ * lwc_string_caseless_isequal with css_lwc_caseless_compare (word-at-a-time
+ * folding) and css_lwc_caseless_isequal (lowercase twins) over pairs drawn
+ * from the element names, classes and ids of a synthetic tree. One in four
+ * pairs differs only in case, as with HTML written in upper case.
+ *
+ * usage: bench-caseless [-r repetitions] [-t ms] [-w ms]
+ */
+#include "bench-util.h"
+#include "synth.h"
+#include "../cocoa-framework/css-lwc-caseless.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  lwc_string *a;
+  lwc_string *b;
+} string_pair;
+
+typedef struct {
+  string_pair *pairs;
+  size_t count;
+} pair_set;
+
+static volatile size_t sink_;
+
+
+static double bench_lwc(void *ctx, size_t loops) {
+  pair_set *set = ctx;
+  size_t matches = 0;
+  for (size_t l = 0; l < loops; l++) {
+    for (size_t i = 0; i < set->count; i++) {
+      bool match = false;
+      lwc_string_caseless_isequal(set->pairs[i].a, set->pairs[i].b, &match);
+      matches += match;
+    }
+  }
+  sink_ += matches;
+  return (double)loops * (double)set->count;
+}
+
+
+static double bench_compare(void *ctx, size_t loops) {
+  pair_set *set = ctx;
+  size_t matches = 0;
+  for (size_t l = 0; l < loops; l++) {
+    for (size_t i = 0; i < set->count; i++)
+      matches += css_lwc_caseless_compare(set->pairs[i].a, set->pairs[i].b);
+  }
+  sink_ += matches;
+  return (double)loops * (double)set->count;
+}
+
+
+static double bench_twins(void *ctx, size_t loops) {
+  pair_set *set = ctx;
+  size_t matches = 0;
+  for (size_t l = 0; l < loops; l++) {
+    for (size_t i = 0; i < set->count; i++)
+      matches += css_lwc_caseless_isequal(set->pairs[i].a, set->pairs[i].b);
+  }
+  sink_ += matches;
+  return (double)loops * (double)set->count;
+}
+
+
+static lwc_string *uppercase(lwc_string *str) {
+  char buf[64];
+  size_t length = lwc_string_length(str);
+  lwc_string *result = NULL;
+  if (length > sizeof(buf)) return lwc_string_ref(str);
+  for (size_t i = 0; i < length; i++) {
+    char c = lwc_string_data(str)[i];
+    buf[i] = (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+  }
+  lwc_intern_string(buf, length, &result);
+  return result;
+}
+
+
+int main(int argc, char **argv) {
+  int arg = bench_parse_options(argc, argv);
+  if (arg < 0 || arg != argc) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-t ms] [-w ms]\n", argv[0]);
+    return 1;
+  }
+
+  synth_tree tree;
+  if (!synth_tree_create(&tree, 2000, 1)) {
+    fprintf(stderr, "bench-caseless: out of memory\n");
+    return 1;
+  }
+
+  // every node name, class and id against one from a random other node
+  pair_set set = { calloc(tree.count * 6, sizeof(string_pair)), 0 };
+  if (!set.pairs) {
+    fprintf(stderr, "bench-caseless: out of memory\n");
+    return 1;
+  }
+  unsigned seed = 1;
+  for (size_t i = 0; i < tree.count; i++) {
+    synth_node *node = &tree.nodes[i];
+    synth_node *other = &tree.nodes[synth_rand(&seed) % tree.count];
+    lwc_string *candidates[3][2] = {
+      { node->name, other->name },
+      { node->id, other->id },
+      { node->n_classes ? node->classes[0] : NULL,
+        other->n_classes ? other->classes[0] : NULL },
+    };
+    for (int c = 0; c < 3; c++) {
+      if (!candidates[c][0] || !candidates[c][1]) continue;
+      string_pair *pair = &set.pairs[set.count++];
+      pair->a = lwc_string_ref(candidates[c][0]);
+      pair->b = synth_rand(&seed) % 4 ? lwc_string_ref(candidates[c][1])
+                                      : uppercase(candidates[c][0]);
+    }
+  }
+
+  bench_measure("caseless.lwc", "ns/op", bench_lwc, &set);
+  bench_measure("caseless.compare", "ns/op", bench_compare, &set);
+  bench_measure("caseless.twins", "ns/op", bench_twins, &set);
+
+  for (size_t i = 0; i < set.count; i++) {
+    lwc_string_unref(set.pairs[i].a);
+    lwc_string_unref(set.pairs[i].b);
+  }
+  free(set.pairs);
+  synth_tree_destroy(&tree);
+  return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Compare two benchmark result files (see bench-util.h) and fail on
+ * significant regressions.
+ *
+ * usage: bench-compare [-p min-percent] [-k mad-factor] baseline.txt new.txt
+ *
+ * For every metric present in both files the median and the median absolute
+ * deviation (MAD) of the samples are computed. A metric has regressed when
+ * it moved in the bad direction (down for rates, up for everything else) by
+ * more than
+ *
+ *   max(min-percent, k * 1.4826 * (MAD_baseline + MAD_new) / median_baseline)
+ *
+ * percent, i.e. by more than the run-to-run noise of either run. Allocation
+ * counts are deterministic, so any increase of an "allocs/op" metric is a
+ * regression. A metric with a baseline of zero has no relative change; any
+ * move in the bad direction from zero is a regression. A metric of the
+ * baseline that is missing from the new results fails the comparison too.
+ *
+ * Exit status: 0 if nothing regressed, 1 on regressions or missing metrics,
+ * 2 on errors.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_METRICS 256
+#define MAX_SAMPLES 100
+#define MAX_NAME 128
+
+typedef struct {
+  char name[MAX_NAME];
+  char unit[MAX_NAME];
+  double samples[MAX_SAMPLES];
+  int n;
+} metric;
+
+typedef struct {
+  metric metrics[MAX_METRICS];
+  int count;
+} result_file;
+
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return x < y ? -1 : x > y;
+}
+
+static double median(double *values, int n) {
+  qsort(values, (size_t)n, sizeof(double), compare_doubles);
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+static double absd(double x) {
+  return x < 0 ? -x : x;
+}
+
+// median absolute deviation around |m|
+static double mad(const metric *mt, double m) {
+  double deviations[MAX_SAMPLES];
+  int i;
+  for (i = 0; i < mt->n; i++)
+    deviations[i] = absd(mt->samples[i] - m);
+  return median(deviations, mt->n);
+}
+
+static int unit_is_rate(const char *unit) {
+  size_t len = strlen(unit);
+  return len > 2 && strcmp(unit + len - 2, "/s") == 0;
+}
+
+
+static int read_results(const char *path, result_file *rf) {
+  char line[8192];
+  FILE *fp = fopen(path, "r");
+  if (fp == NULL) {
+    perror(path);
+    return 0;
+  }
+  rf->count = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    metric *mt;
+    char *token, *save = NULL;
+    if (line[0] == '#' || line[0] == '\n')
+      continue;
+    if (rf->count == MAX_METRICS) {
+      fprintf(stderr, "%s: too many metrics\n", path);
+      break;
+    }
+    mt = &rf->metrics[rf->count];
+    token = strtok_r(line, " \t\n", &save);
+    if (token == NULL)
+      continue;
+    snprintf(mt->name, sizeof(mt->name), "%s", token);
+    token = strtok_r(NULL, " \t\n", &save);
+    if (token == NULL)
+      continue;
+    snprintf(mt->unit, sizeof(mt->unit), "%s", token);
+    mt->n = 0;
+    while ((token = strtok_r(NULL, " \t\n", &save)) && mt->n < MAX_SAMPLES)
+      mt->samples[mt->n++] = strtod(token, NULL);
+    if (mt->n > 0)
+      rf->count++;
+  }
+  fclose(fp);
+  return 1;
+}
+
+static metric *find_metric(result_file *rf, const char *name) {
+  int i;
+  for (i = 0; i < rf->count; i++) {
+    if (strcmp(rf->metrics[i].name, name) == 0)
+      return &rf->metrics[i];
+  }
+  return NULL;
+}
+
+
+int main(int argc, char **argv) {
+  static result_file base, cur;
+  double min_percent = 5.0, k = 3.0;
+  int regressions = 0, missing = 0, compared = 0;
+  int i = 1;
+
+  for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+    if (strcmp(argv[i], "-p") == 0) min_percent = strtod(argv[i + 1], NULL);
+    else if (strcmp(argv[i], "-k") == 0) k = strtod(argv[i + 1], NULL);
+    else break;
+  }
+  if (argc - i != 2) {
+    fprintf(stderr, "usage: %s [-p min-percent] [-k mad-factor] "
+                    "baseline.txt new.txt\n", argv[0]);
+    return 2;
+  }
+  if (!read_results(argv[i], &base) || !read_results(argv[i + 1], &cur))
+    return 2;
+
+  printf("%-28s %12s %12s %9s %9s\n", "metric", "baseline", "new",
+         "change%", "limit%");
+  for (i = 0; i < base.count; i++) {
+    metric *b = &base.metrics[i];
+    metric *c = find_metric(&cur, b->name);
+    double bm, cm, noise, limit, change, worse;
+    int allocs;
+    if (c == NULL) {
+      printf("%-28s missing from new results  MISSING\n", b->name);
+      missing++;
+      continue;
+    }
+    bm = median(b->samples, b->n);
+    cm = median(c->samples, c->n);
+    noise = 1.4826 * (mad(b, bm) + mad(c, cm));
+    if (bm != 0)
+      change = (cm - bm) * 100.0 / bm;
+    else
+      change = cm > 0 ? HUGE_VAL : cm < 0 ? -HUGE_VAL : 0;
+    // positive |worse| means slower / more allocations
+    worse = unit_is_rate(b->unit) ? -change : change;
+    allocs = strcmp(b->unit, "allocs/op") == 0;
+    limit = allocs ? 0 : min_percent;
+    if (!allocs && bm != 0 && k * noise * 100.0 / absd(bm) > limit)
+      limit = k * noise * 100.0 / absd(bm);
+    compared++;
+
+    printf("%-28s %12.6g %12.6g %+8.2f%% %8.2f%%", b->name, bm, cm, change,
+           limit);
+    if (worse > limit) {
+      printf("  REGRESSION");
+      regressions++;
+    } else if (-worse > limit) {
+      printf("  improved");
+    }
+    printf("\n");
+  }
+
+  if (compared == 0 && missing == 0) {
+    fprintf(stderr, "bench-compare: no metrics in common\n");
+    return 2;
+  }
+  if (missing)
+    printf("%d metrics missing from new results\n", missing);
+  if (regressions)
+    printf("%d of %d metrics regressed\n", regressions, compared);
+  if (regressions || missing)
+    return 1;
+  return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * lwc_intern_string throughput from 1 up to N threads, straight into
+ * libwapcaplet's sharded table, over the element names, classes and ids of
+ * a synthetic tree, each followed by lwc_string_unref. Measures how well
+ * the table scales with threads, on every platform; bench-intern adds the
+ * framework's cache on OS X.
+ *
+ * usage: bench-intern-lwc [-r repetitions] [-t ms] [-w ms] [max threads]
+ */
+#include "bench-util.h"
+#include "synth.h"
+
+#include <libwapcaplet/libwapcaplet.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+  char *utf8;  // the strings' bytes, NUL separated
+  size_t length;
+  size_t count;
+  size_t threads;
+  size_t loops;  // of the current measurement
+} intern_bench;
+
+
+static void *intern_thread(void *ctx) {
+  intern_bench *b = ctx;
+  const char *end = b->utf8 + b->length;
+  for (size_t l = 0; l < b->loops; l++) {
+    for (const char *p = b->utf8; p < end; ) {
+      size_t length = strlen(p);
+      lwc_string *str;
+      if (lwc_intern_string(p, length, &str) == lwc_error_ok)
+        lwc_string_unref(str);
+      p += length + 1;
+    }
+  }
+  return NULL;
+}
+
+
+static double bench_intern_lwc(void *ctx, size_t loops) {
+  intern_bench *b = ctx;
+  pthread_t ids[b->threads];
+  size_t started = 0;
+  b->loops = loops;
+  // the calling thread is the first one
+  for (; started + 1 < b->threads; started++) {
+    if (pthread_create(&ids[started], NULL, intern_thread, b) != 0) break;
+  }
+  intern_thread(b);
+  for (size_t t = 0; t < started; t++)
+    pthread_join(ids[t], NULL);
+  return (double)loops * (double)b->count * (double)(started + 1);
+}
+
+
+static int add_string(intern_bench *b, lwc_string *str, size_t *capacity) {
+  size_t length = lwc_string_length(str);
+  if (b->length + length + 1 > *capacity) {
+    size_t grown = *capacity * 2 + length + 1;
+    char *utf8 = realloc(b->utf8, grown);
+    if (!utf8) return 0;
+    b->utf8 = utf8;
+    *capacity = grown;
+  }
+  memcpy(b->utf8 + b->length, lwc_string_data(str), length);
+  b->utf8[b->length + length] = '\0';
+  b->length += length + 1;
+  b->count++;
+  return 1;
+}
+
+
+int main(int argc, char **argv) {
+  int arg = bench_parse_options(argc, argv);
+  if (arg < 0 || argc - arg > 1) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-t ms] [-w ms] "
+                    "[max threads]\n", argv[0]);
+    return 1;
+  }
+  long maxThreads = arg < argc ? atol(argv[arg])
+                               : sysconf(_SC_NPROCESSORS_ONLN);
+  if (maxThreads < 1) maxThreads = 1;
+
+  // names, ids and classes in the proportions they occur in the tree
+  synth_tree tree;
+  if (!synth_tree_create(&tree, 2000, 1)) {
+    fprintf(stderr, "bench-intern-lwc: out of memory\n");
+    return 1;
+  }
+  intern_bench b;
+  size_t capacity = 0;
+  memset(&b, 0, sizeof(b));
+  for (size_t i = 0; i < tree.count; i++) {
+    synth_node *node = &tree.nodes[i];
+    int ok = add_string(&b, node->name, &capacity);
+    if (node->id) ok = ok && add_string(&b, node->id, &capacity);
+    for (uint32_t c = 0; c < node->n_classes; c++)
+      ok = ok && add_string(&b, node->classes[c], &capacity);
+    if (!ok) {
+      fprintf(stderr, "bench-intern-lwc: out of memory\n");
+      return 1;
+    }
+  }
+
+  for (size_t threads = 1; threads <= (size_t)maxThreads; threads *= 2) {
+    char metric[64];
+    b.threads = threads;
+    snprintf(metric, sizeof(metric), "intern.lwc.threads%zu", threads);
+    bench_measure(metric, "ops/s", bench_intern_lwc, &b);
+  }
+
+  free(b.utf8);
+  synth_tree_destroy(&tree);
+  return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Interning throughput of -[NSString LWCString] (through the framework's
+ * cache) from 1 up to N threads, over the element names, classes and ids of
+ * a synthetic tree, each followed by lwc_string_unref. Built by build.sh
+ * --bench on OS X only; bench-intern-lwc measures lwc_intern_string alone
+ * on every platform.
+ *
+ * usage: bench-intern [-r repetitions] [-t ms] [-w ms] [max threads]
+ */
+#import <CSS/CSS.h>
+
+#import "bench-util.h"
+#import "synth.h"
+
+typedef struct {
+  NSArray *strings;
+  size_t threads;
+} intern_bench;
+
+
+static double bench_intern(void *ctx, size_t loops) {
+  intern_bench *b = (intern_bench*)ctx;
+  NSArray *strings = b->strings;
+  dispatch_apply(b->threads, dispatch_get_global_queue(0, 0), ^(size_t t) {
+    for (size_t l = 0; l < loops; l++) {
+      for (NSString *string in strings)
+        lwc_string_unref(string.LWCString);
+    }
+  });
+  return (double)loops * (double)strings.count * (double)b->threads;
+}
+
+
+static void add_string(NSMutableArray *strings, lwc_string *str) {
+  // plain NSStrings, not ones bridged from |str|, which would skip the cache
+  [strings addObject:[[[NSString alloc] initWithBytes:lwc_string_data(str)
+                                               length:lwc_string_length(str)
+                                             encoding:NSUTF8StringEncoding]
+                      autorelease]];
+}
+
+
+int main(int argc, char **argv) {
+  NSAutoreleasePool *pool = [NSAutoreleasePool new];
+  int arg = bench_parse_options(argc, argv);
+  if (arg < 0 || argc - arg > 1) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-t ms] [-w ms] "
+                    "[max threads]\n", argv[0]);
+    return 1;
+  }
+  size_t maxThreads = arg < argc ? (size_t)atoi(argv[arg])
+                                 : [[NSProcessInfo processInfo]
+                                    activeProcessorCount];
+  if (maxThreads < 1) maxThreads = 1;
+
+  // names, ids and classes in the proportions they occur in the tree
+  synth_tree tree;
+  if (!synth_tree_create(&tree, 2000, 1)) {
+    fprintf(stderr, "bench-intern: out of memory\n");
+    return 1;
+  }
+  NSMutableArray *strings = [NSMutableArray array];
+  for (size_t i = 0; i < tree.count; i++) {
+    synth_node *node = &tree.nodes[i];
+    add_string(strings, node->name);
+    if (node->id) add_string(strings, node->id);
+    for (uint32_t c = 0; c < node->n_classes; c++)
+      add_string(strings, node->classes[c]);
+  }
+
+  for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+    intern_bench b = { strings, threads };
+    char metric[64];
+    snprintf(metric, sizeof(metric), "intern.threads%zu", threads);
+    bench_measure(metric, "ops/s", bench_intern, &b);
+  }
+
+  synth_tree_destroy(&tree);
+  [pool drain];
+  return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Cost of the CSSStyle property accessors, measured over composed styles
+ * for a synthetic tree. Built by build.sh --bench on OS X only.
+ *
+ * usage: bench-style [-r repetitions] [-t ms] [-w ms] [sheet.css ...]
+ */
+#import <CSS/CSS.h>
+
+#import "bench-util.h"
+#import "synth.h"
+
+typedef struct {
+  NSArray *styles;
+  void (^accessor)(CSSStyle*);
+} accessor_bench;
+
+static volatile uintptr_t sink_;
+
+
+static double bench_accessor(void *ctx, size_t loops) {
+  accessor_bench *b = (accessor_bench*)ctx;
+  for (size_t l = 0; l < loops; l++) {
+    NSAutoreleasePool *pool = [NSAutoreleasePool new];
+    for (CSSStyle *style in b->styles) {
+      b->accessor(style);
+    }
+    [pool drain];
+  }
+  return (double)loops * (double)b->styles.count;
+}
+
+
+static void measure(NSArray *styles, const char *metric,
+                    void (^accessor)(CSSStyle*)) {
+  accessor_bench b = { styles, accessor };
+  bench_measure(metric, "ns/op", bench_accessor, &b);
+}
+
+
+int main(int argc, char **argv) {
+  NSAutoreleasePool *pool = [NSAutoreleasePool new];
+  int arg = bench_parse_options(argc, argv);
+  if (arg < 0) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-t ms] [-w ms] "
+                    "[stylesheet.css ...]\n", argv[0]);
+    return 1;
+  }
+
+  // stylesheets
+  CSSContext *context = [[CSSContext alloc] init];
+  for (; arg < argc; arg++) {
+    NSString *path = [NSString stringWithUTF8String:argv[arg]];
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    if (!data) {
+      perror(argv[arg]);
+      return 1;
+    }
+    CSSStylesheet *stylesheet =
+        [[CSSStylesheet alloc] initWithURL:[NSURL fileURLWithPath:path]];
+    [stylesheet loadData:data withCallback:^(NSError *error) {
+      if (error) NSLog(@"%@: %@", path, error);
+    }];
+    [context addStylesheet:stylesheet];
+    [stylesheet release];
+  }
+  size_t length = 0;
+  char *generated = synth_stylesheet(2000, 1, &length);
+  CSSStylesheet *stylesheet = [[CSSStylesheet alloc] initWithURL:nil];
+  [stylesheet loadData:[NSData dataWithBytesNoCopy:generated length:length]
+          withCallback:^(NSError *error) {
+    if (error) NSLog(@"generated stylesheet: %@", error);
+  }];
+  [context addStylesheet:stylesheet];
+  [stylesheet release];
+
+  // select and compose styles for a synthetic tree
+  css_select_handler handler;
+  synth_handler_init(&handler);
+  synth_tree tree;
+  if (!synth_tree_create(&tree, 2000, 1)) {
+    fprintf(stderr, "bench-style: out of memory\n");
+    return 1;
+  }
+  NSMutableArray *styles = [NSMutableArray arrayWithCapacity:tree.count];
+  for (size_t i = 0; i < tree.count; i++) {
+    synth_node *node = &tree.nodes[i];
+    CSSStyle *style = [CSSStyle selectStyleForObject:node
+                                           inContext:context
+                                       pseudoElement:0
+                                               media:CSS_MEDIA_SCREEN
+                                         inlineStyle:nil
+                                        usingHandler:&handler];
+    if (node->parent) {
+      style = [[styles objectAtIndex:node->parent - tree.nodes]
+               mergeWith:style];
+    }
+    [styles addObject:style];
+  }
+
+  measure(styles, "style.color", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.color;
+  });
+  measure(styles, "style.backgroundColor", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.backgroundColor;
+  });
+  measure(styles, "style.borderTopWidth", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.borderTopWidth;
+  });
+  measure(styles, "style.width", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.width;
+  });
+  measure(styles, "style.fontSize", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.fontSize;
+  });
+  measure(styles, "style.fontWeight", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.fontWeight;
+  });
+  measure(styles, "style.fontFamilyNames", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.fontFamilyNames;
+  });
+  measure(styles, "style.font", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.font;
+  });
+  measure(styles, "style.cursor", ^(CSSStyle *s) {
+    sink_ += (uintptr_t)s.cursor;
+  });
+
+  [styles removeAllObjects];
+  [context release];
+  synth_tree_destroy(&tree);
+  [pool drain];
+  return 0;
+}
@@ -0,0 +1,118 @@
+#include "bench-util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __APPLE__
+  #include <mach/mach_time.h>
+#else
+  #include <time.h>
+#endif
+
+bench_config bench_options = { 10, 200, 500, NULL, NULL };
+
+
+uint64_t bench_now(void) {
+#ifdef __APPLE__
+  static mach_timebase_info_data_t timebase;
+  if (timebase.denom == 0)
+    mach_timebase_info(&timebase);
+  return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+
+int bench_parse_options(int argc, char **argv) {
+  return bench_parse_options_with(argc, argv, "", NULL, NULL);
+}
+
+
+int bench_parse_options_with(int argc, char **argv, const char *extra,
+                             bench_option_fn handler, void *ctx) {
+  char optstring[64];
+  int opt;
+  snprintf(optstring, sizeof(optstring), "r:t:w:%s", extra);
+  while ((opt = getopt(argc, argv, optstring)) != -1) {
+    switch (opt) {
+      case 'r': bench_options.repetitions = atoi(optarg); break;
+      case 't': bench_options.rep_ms = atoi(optarg); break;
+      case 'w': bench_options.warmup_ms = atoi(optarg); break;
+      case '?': return -1;
+      default:
+        if (!handler || !handler(opt, optarg, ctx)) return -1;
+    }
+  }
+  if (bench_options.repetitions < 1 ||
+      bench_options.repetitions > BENCH_MAX_REPETITIONS ||
+      bench_options.rep_ms < 1 || bench_options.warmup_ms < 0) {
+    return -1;
+  }
+  return optind;
+}
+
+
+static int unit_is_rate(const char *unit) {
+  size_t len = strlen(unit);
+  return len > 2 && strcmp(unit + len - 2, "/s") == 0;
+}
+
+
+void bench_measure(const char *metric, const char *unit, bench_fn fn,
+                   void *ctx) {
+  double samples[BENCH_MAX_REPETITIONS];
+  double allocs[BENCH_MAX_REPETITIONS];
+  uint64_t warmup_ns = (uint64_t)bench_options.warmup_ms * 1000000ull;
+  uint64_t rep_ns = (uint64_t)bench_options.rep_ms * 1000000ull;
+  const uint64_t *counter = bench_options.alloc_counter;
+  uint64_t start, elapsed = 0;
+  size_t loops = 1;
+  int i;
+
+  if (bench_options.output == NULL)
+    bench_options.output = stdout;
+  fprintf(stderr, "bench: %s...\n", metric);
+
+  // warmup: grow the loop count until one call takes >= 1/8 of the
+  // repetition target, then keep running until the warmup time is spent
+  start = bench_now();
+  do {
+    uint64_t t = bench_now();
+    fn(ctx, loops);
+    elapsed = bench_now() - t;
+    if (elapsed < rep_ns / 8)
+      loops *= 2;
+  } while (bench_now() - start < warmup_ns || elapsed < rep_ns / 8);
+
+  // scale loops so that one repetition takes about rep_ms
+  if (elapsed > 0)
+    loops = (size_t)((double)loops * (double)rep_ns / (double)elapsed);
+  if (loops < 1)
+    loops = 1;
+
+  for (i = 0; i < bench_options.repetitions; i++) {
+    uint64_t a = counter ? *counter : 0;
+    uint64_t t = bench_now();
+    double work = fn(ctx, loops);
+    double ns = (double)(bench_now() - t);
+    if (ns < 1.0)
+      ns = 1.0;
+    samples[i] = unit_is_rate(unit) ? work * 1e9 / ns : ns / work;
+    allocs[i] = counter ? (double)(*counter - a) / work : 0;
+  }
+
+  fprintf(bench_options.output, "%s %s", metric, unit);
+  for (i = 0; i < bench_options.repetitions; i++)
+    fprintf(bench_options.output, " %.6g", samples[i]);
+  fprintf(bench_options.output, "\n");
+  if (counter) {
+    fprintf(bench_options.output, "%s.allocs allocs/op", metric);
+    for (i = 0; i < bench_options.repetitions; i++)
+      fprintf(bench_options.output, " %.6g", allocs[i]);
+    fprintf(bench_options.output, "\n");
+  }
+  fflush(bench_options.output);
+}
@@ -0,0 +1,67 @@
+/*
+ * Benchmark harness shared by the tools/bench* drivers.
+ *
+ * Each metric is measured by calling a benchmark function with a loop count
+ * calibrated during warmup, so that every repetition runs for roughly
+ * |rep_ms| milliseconds. One line is printed per metric:
+ *
+ *   <metric> <unit> <sample 1> ... <sample N>
+ *
+ * where each sample is one repetition. For rate units ("bytes/s",
+ * "nodes/s", ...) higher is better; for "ns/op" lower is better. When an
+ * allocation counter is configured, a second line
+ *
+ *   <metric>.allocs allocs/op <sample 1> ... <sample N>
+ *
+ * reports allocations per unit of work.
+ */
+#ifndef CSS_TOOLS_BENCH_UTIL_H_
+#define CSS_TOOLS_BENCH_UTIL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define BENCH_MAX_REPETITIONS 100
+
+typedef struct {
+  int repetitions;  // samples per metric
+  int rep_ms;       // target duration of one repetition
+  int warmup_ms;    // time spent warming up and calibrating
+  FILE *output;     // where result lines go (stdout)
+  const uint64_t *alloc_counter;  // incremented per allocation, or NULL
+} bench_config;
+
+extern bench_config bench_options;
+
+/**
+ * A benchmark body. Runs the measured operation |loops| times and returns
+ * the amount of work done (bytes, nodes, operations) in the unit of the
+ * metric's numerator.
+ */
+typedef double (*bench_fn)(void *ctx, size_t loops);
+
+/// Monotonic time in nanoseconds
+uint64_t bench_now(void);
+
+/**
+ * Parse the common -r <repetitions> -t <ms per repetition> -w <warmup ms>
+ * options. Returns the index of the first argument which is not an option,
+ * or -1 on a usage error (including unknown options).
+ */
+int bench_parse_options(int argc, char **argv);
+
+/**
+ * Like bench_parse_options, also accepting the options in |extra| (in
+ * getopt syntax), in any order among the common ones. Each of those is
+ * passed to |handler|, which returns 0 to reject its value.
+ */
+typedef int (*bench_option_fn)(int opt, const char *value, void *ctx);
+int bench_parse_options_with(int argc, char **argv, const char *extra,
+                             bench_option_fn handler, void *ctx);
+
+/// Warm up, calibrate, measure and print one metric
+void bench_measure(const char *metric, const char *unit, bench_fn fn,
+                   void *ctx);
+
+#endif  // CSS_TOOLS_BENCH_UTIL_H_
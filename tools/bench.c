@@ -0,0 +1,223 @@
+/*
+ * libcss hot path benchmarks: parsing, selection and composition.
+ *
+ * usage: bench [-r repetitions] [-t ms] [-w ms] [-n nodes] [sheet.css ...]
+ *
+ * Results go to stdout in the bench-util.h format; build.sh --bench writes
+ * them to bench_output.txt.
+ */
+#include "bench-util.h"
+#include "synth.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_INPUTS 64
+
+typedef struct {
+  uint8_t *data;
+  size_t length;
+} input;
+
+typedef struct {
+  input inputs[MAX_INPUTS];
+  size_t n_inputs;
+} parse_bench;
+
+typedef struct {
+  css_select_ctx *ctx;
+  css_select_handler handler;
+  synth_tree tree;
+  css_computed_style **selected;  // per node, partial (uncomposed) styles
+} select_bench;
+
+
+static void die(const char *text, css_error code) {
+  fprintf(stderr, "bench: %s: %s\n", text, css_error_to_string(code));
+  exit(1);
+}
+
+static css_error resolve_url(void *pw, const char *base, lwc_string *rel,
+                             lwc_string **abs) {
+  (void)pw; (void)base;
+  *abs = lwc_string_ref(rel);
+  return CSS_OK;
+}
+
+static css_stylesheet *parse(const input *in) {
+  css_stylesheet *sheet;
+  css_error code;
+
+  code = css_stylesheet_create(CSS_LEVEL_DEFAULT, "UTF-8", "", NULL,
+      false, false, synth_realloc, NULL, resolve_url, NULL, NULL, NULL,
+      &sheet);
+  if (code != CSS_OK)
+    die("css_stylesheet_create", code);
+  code = css_stylesheet_append_data(sheet, in->data, in->length);
+  if (code != CSS_OK && code != CSS_NEEDDATA)
+    die("css_stylesheet_append_data", code);
+  code = css_stylesheet_data_done(sheet);
+  if (code != CSS_OK && code != CSS_IMPORTS_PENDING)
+    die("css_stylesheet_data_done", code);
+  return sheet;
+}
+
+static css_computed_style *create_style(void) {
+  css_computed_style *style;
+  css_error code = css_computed_style_create(synth_realloc, NULL, &style);
+  if (code != CSS_OK)
+    die("css_computed_style_create", code);
+  return style;
+}
+
+static void select_node(select_bench *b, synth_node *node,
+                        css_computed_style *style) {
+  css_error code = css_select_style(b->ctx, node, 0, CSS_MEDIA_SCREEN, NULL,
+                                    style, &b->handler, NULL);
+  if (code != CSS_OK)
+    die("css_select_style", code);
+}
+
+
+// bytes/s through css_stylesheet_append_data + css_stylesheet_data_done
+static double bench_parse(void *ctx, size_t loops) {
+  parse_bench *b = ctx;
+  double bytes = 0;
+  size_t l, i;
+  for (l = 0; l < loops; l++) {
+    for (i = 0; i < b->n_inputs; i++) {
+      css_stylesheet_destroy(parse(&b->inputs[i]));
+      bytes += (double)b->inputs[i].length;
+    }
+  }
+  return bytes;
+}
+
+// nodes/s through css_select_style, including creating and destroying the
+// computed style as CSSStyle does
+static double bench_select(void *ctx, size_t loops) {
+  select_bench *b = ctx;
+  size_t l, i;
+  for (l = 0; l < loops; l++) {
+    for (i = 0; i < b->tree.count; i++) {
+      css_computed_style *style = create_style();
+      select_node(b, &b->tree.nodes[i], style);
+      css_computed_style_destroy(style);
+    }
+  }
+  return (double)loops * (double)b->tree.count;
+}
+
+// styles/s through css_computed_style_compose, composing every node's
+// selected style with its parent's composed style in document order
+static double bench_compose(void *ctx, size_t loops) {
+  select_bench *b = ctx;
+  size_t count = b->tree.count;
+  css_computed_style **composed = malloc(count * sizeof(*composed));
+  size_t l, i;
+  if (composed == NULL)
+    die("malloc", CSS_NOMEM);
+  for (l = 0; l < loops; l++) {
+    composed[0] = b->selected[0];
+    for (i = 1; i < count; i++) {
+      synth_node *node = &b->tree.nodes[i];
+      css_error code;
+      composed[i] = create_style();
+      code = css_computed_style_compose(composed[node->parent - b->tree.nodes],
+          b->selected[i], b->handler.compute_font_size, NULL, composed[i]);
+      if (code != CSS_OK)
+        die("css_computed_style_compose", code);
+    }
+    for (i = 1; i < count; i++)
+      css_computed_style_destroy(composed[i]);
+  }
+  free(composed);
+  return (double)loops * (double)(count - 1);
+}
+
+
+// -n <nodes>
+static int parse_nodes(int opt, const char *value, void *ctx) {
+  (void)opt;
+  *(size_t *)ctx = (size_t)strtoul(value, NULL, 10);
+  return 1;
+}
+
+
+int main(int argc, char **argv) {
+  parse_bench pb;
+  select_bench sb;
+  css_stylesheet *sheets[MAX_INPUTS];
+  size_t nodes = 10000;
+  css_error code;
+  size_t i;
+  int arg = bench_parse_options_with(argc, argv, "n:", parse_nodes, &nodes);
+
+  if (arg < 0 || nodes < 2) {
+    fprintf(stderr, "usage: %s [-r repetitions] [-t ms] [-w ms] [-n nodes] "
+                    "[stylesheet.css ...]\n", argv[0]);
+    return 1;
+  }
+
+  // inputs: the given sheets followed by a generated one
+  memset(&pb, 0, sizeof(pb));
+  for (; arg < argc && pb.n_inputs < MAX_INPUTS - 1; arg++) {
+    input *in = &pb.inputs[pb.n_inputs++];
+    in->data = synth_read_file(argv[arg], &in->length);
+    if (in->data == NULL) {
+      perror(argv[arg]);
+      return 1;
+    }
+  }
+  pb.inputs[pb.n_inputs].data =
+      (uint8_t *)synth_stylesheet(2000, 1, &pb.inputs[pb.n_inputs].length);
+  if (pb.inputs[pb.n_inputs++].data == NULL)
+    die("synth_stylesheet", CSS_NOMEM);
+
+  bench_options.alloc_counter = &synth_alloc_calls;
+
+  printf("# css-bench 1\n");
+  printf("# metric unit samples (repetitions=%d, ms=%d)\n",
+         bench_options.repetitions, bench_options.rep_ms);
+
+  bench_measure("parse", "bytes/s", bench_parse, &pb);
+
+  // selection context over all inputs
+  memset(&sb, 0, sizeof(sb));
+  synth_handler_init(&sb.handler);
+  code = css_select_ctx_create(synth_realloc, NULL, &sb.ctx);
+  if (code != CSS_OK)
+    die("css_select_ctx_create", code);
+  for (i = 0; i < pb.n_inputs; i++) {
+    sheets[i] = parse(&pb.inputs[i]);
+    code = css_select_ctx_append_sheet(sb.ctx, sheets[i], CSS_ORIGIN_AUTHOR,
+                                       CSS_MEDIA_ALL);
+    if (code != CSS_OK)
+      die("css_select_ctx_append_sheet", code);
+  }
+  if (!synth_tree_create(&sb.tree, nodes, 1))
+    die("synth_tree_create", CSS_NOMEM);
+
+  bench_measure("select", "nodes/s", bench_select, &sb);
+
+  sb.selected = malloc(sb.tree.count * sizeof(*sb.selected));
+  if (sb.selected == NULL)
+    die("malloc", CSS_NOMEM);
+  for (i = 0; i < sb.tree.count; i++) {
+    sb.selected[i] = create_style();
+    select_node(&sb, &sb.tree.nodes[i], sb.selected[i]);
+  }
+
+  bench_measure("compose", "styles/s", bench_compose, &sb);
+
+  for (i = 0; i < sb.tree.count; i++)
+    css_computed_style_destroy(sb.selected[i]);
+  free(sb.selected);
+  synth_tree_destroy(&sb.tree);
+  css_select_ctx_destroy(sb.ctx);
+  for (i = 0; i < pb.n_inputs; i++) {
+    css_stylesheet_destroy(sheets[i]);
+    free(pb.inputs[i].data);
+  }
+  return 0;
+}
@@ -0,0 +1,249 @@
+/*
+ * Generates cocoa-framework/css-atoms.h and css-atoms.m from a list of
+ * strings (tools/atoms.txt): an enum of CSS_ATOM_* indices, the table of
+ * lwc_strings interned for them at load time and a perfect hash from bytes
+ * to atom index.
+ *
+ * The hash is seeded FNV-1a. Table sizes are tried in increasing powers of
+ * two, and for each size a number of seeds, until a seed maps every string
+ * to a different slot.
+ *
+ * usage: gen-atoms <atoms.txt> <output directory>
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_ATOMS 1024
+#define MAX_LENGTH 64
+#define SEEDS_PER_SIZE 100000
+
+static char names[MAX_ATOMS][MAX_LENGTH + 1];
+static size_t lengths[MAX_ATOMS];
+static size_t count = 0;
+
+
+// Must match _hash in the generated css-atoms.m
+static uint32_t hash(const char *data, size_t length, uint32_t seed) {
+  uint32_t h = 2166136261u ^ seed;
+  for (size_t i = 0; i < length; i++) {
+    h ^= (uint8_t)data[i];
+    h *= 16777619u;
+  }
+  return h ^ (h >> 15);
+}
+
+
+static void add(const char *name, size_t length) {
+  if (count == MAX_ATOMS) {
+    fprintf(stderr, "gen-atoms: more than %d atoms\n", MAX_ATOMS);
+    exit(1);
+  }
+  if (length > MAX_LENGTH) {
+    fprintf(stderr, "gen-atoms: \"%.*s\" is too long\n", (int)length, name);
+    exit(1);
+  }
+  for (size_t i = 0; i < count; i++) {
+    if (lengths[i] == length && memcmp(names[i], name, length) == 0) {
+      fprintf(stderr, "gen-atoms: duplicate atom \"%s\"\n", names[i]);
+      exit(1);
+    }
+  }
+  memcpy(names[count], name, length);
+  names[count][length] = '\0';
+  lengths[count++] = length;
+}
+
+
+static void read_atoms(const char *path) {
+  FILE *f = fopen(path, "r");
+  char line[256];
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  add("", 0);
+  while (fgets(line, sizeof(line), f)) {
+    size_t length = strcspn(line, "\r\n");
+    if (length == 0 || line[0] == '#') continue;
+    add(line, length);
+  }
+  fclose(f);
+}
+
+
+static int try_seed(uint32_t seed, size_t size, uint16_t *table) {
+  for (size_t i = 0; i < size; i++)
+    table[i] = 0xffff;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t slot = hash(names[i], lengths[i], seed) & (uint32_t)(size - 1);
+    if (table[slot] != 0xffff) return 0;
+    table[slot] = (uint16_t)i;
+  }
+  return 1;
+}
+
+
+static FILE *open_output(const char *dir, const char *name) {
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    perror(path);
+    exit(1);
+  }
+  fprintf(f, "// Generated by tools/gen-atoms from tools/atoms.txt. "
+             "Do not edit.\n");
+  return f;
+}
+
+
+static void write_identifier(FILE *f, size_t i) {
+  if (i == 0) {
+    fputs("EMPTY", f);
+    return;
+  }
+  for (const char *p = names[i]; *p; p++)
+    fputc(*p == '-' ? '_' : *p, f);
+}
+
+
+static void write_header(const char *dir) {
+  FILE *f = open_output(dir, "css-atoms.h");
+  fputs("#ifndef CSS_ATOMS_H_\n"
+        "#define CSS_ATOMS_H_\n"
+        "\n"
+        "#include <stddef.h>\n"
+        "#include <libwapcaplet/libwapcaplet.h>\n"
+        "\n"
+        "/**\n"
+        " * Strings interned once when the framework is loaded, for handlers\n"
+        " * which would otherwise intern the same element and attribute names\n"
+        " * over and over again: CSS_ATOM(div) is the lwc_string \"div\".\n"
+        " * Atoms live for the lifetime of the process, so they can be\n"
+        " * returned from handlers with just lwc_string_ref and compared by\n"
+        " * pointer with other interned strings.\n"
+        " */\n"
+        "\n"
+        "enum {\n", f);
+  for (size_t i = 0; i < count; i++) {
+    fputs("  CSS_ATOM_", f);
+    write_identifier(f, i);
+    fprintf(f, ",%s\n", i == 0 ? "  // \"\"" : "");
+  }
+  fputs("  CSS_ATOM_COUNT\n"
+        "};\n"
+        "\n"
+        "extern lwc_string *css_atoms[CSS_ATOM_COUNT];\n"
+        "\n"
+        "#define CSS_ATOM(name) (css_atoms[CSS_ATOM_##name])\n"
+        "\n"
+        "/// Index of the atom with the given bytes, or -1 if there is none\n"
+        "int css_atom_lookup(const char *data, size_t length);\n"
+        "\n"
+        "#endif  // CSS_ATOMS_H_\n", f);
+  fclose(f);
+}
+
+
+static void write_source(const char *dir, uint32_t seed, size_t size,
+                         const uint16_t *table) {
+  FILE *f = open_output(dir, "css-atoms.m");
+  fputs("#import <libwapcaplet/libwapcaplet.h>\n"
+        "#import \"css-atoms.h\"\n"
+        "#import <stdio.h>\n"
+        "#import <stdlib.h>\n"
+        "#import <string.h>\n"
+        "\n"
+        "lwc_string *css_atoms[CSS_ATOM_COUNT];\n"
+        "\n"
+        "static const char * const kNames[CSS_ATOM_COUNT] = {\n", f);
+  for (size_t i = 0; i < count; i++)
+    fprintf(f, "  \"%s\",\n", names[i]);
+  fputs("};\n\nstatic const uint8_t kLengths[CSS_ATOM_COUNT] = {", f);
+  for (size_t i = 0; i < count; i++)
+    fprintf(f, "%s%zu,", i % 16 ? " " : "\n  ", lengths[i]);
+  fprintf(f, "\n};\n"
+             "\n"
+             "#define kSeed 0x%08xu\n"
+             "#define kTableSize %zu\n"
+             "\n"
+             "// atom index by hash slot, 0xffff for empty slots\n"
+             "static const uint16_t kTable[kTableSize] = {", seed, size);
+  for (size_t i = 0; i < size; i++) {
+    if (table[i] == 0xffff)
+      fprintf(f, "%s0xffff,", i % 8 ? " " : "\n  ");
+    else
+      fprintf(f, "%s%6u,", i % 8 ? " " : "\n  ", table[i]);
+  }
+  fputs("\n};\n"
+        "\n"
+        "\n"
+        "static inline uint32_t _hash(const char *data, size_t length) {\n"
+        "  uint32_t h = 2166136261u ^ kSeed;\n"
+        "  size_t i;\n"
+        "  for (i = 0; i < length; i++) {\n"
+        "    h ^= (uint8_t)data[i];\n"
+        "    h *= 16777619u;\n"
+        "  }\n"
+        "  return h ^ (h >> 15);\n"
+        "}\n"
+        "\n"
+        "\n"
+        "int css_atom_lookup(const char *data, size_t length) {\n"
+        "  uint16_t i = kTable[_hash(data, length) & (kTableSize - 1)];\n"
+        "  if (i != 0xffff && kLengths[i] == length &&\n"
+        "      memcmp(kNames[i], data, length) == 0)\n"
+        "    return i;\n"
+        "  return -1;\n"
+        "}\n"
+        "\n"
+        "\n"
+        "__attribute__((constructor))\n"
+        "static void _internAtoms(void) {\n"
+        "  int i;\n"
+        "  for (i = 0; i < CSS_ATOM_COUNT; i++) {\n"
+        "    // handlers use atoms unchecked, so there is no way to go on\n"
+        "    if (lwc_intern_string(kNames[i], kLengths[i], &css_atoms[i]) !=\n"
+        "        lwc_error_ok) {\n"
+        "      fprintf(stderr, \"CSS: could not intern atom \\\"%s\\\"\\n\",\n"
+        "              kNames[i]);\n"
+        "      abort();\n"
+        "    }\n"
+        "  }\n"
+        "}\n", f);
+  fclose(f);
+}
+
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <atoms.txt> <output directory>\n", argv[0]);
+    return 1;
+  }
+  read_atoms(argv[1]);
+
+  size_t size = 1;
+  while (size < count * 2) size <<= 1;
+  for (; size <= 0x8000; size <<= 1) {
+    uint16_t *table = malloc(size * sizeof(uint16_t));
+    if (!table) {
+      fprintf(stderr, "gen-atoms: out of memory\n");
+      return 1;
+    }
+    for (uint32_t seed = 1; seed <= SEEDS_PER_SIZE; seed++) {
+      if (try_seed(seed, size, table)) {
+        write_header(argv[2]);
+        write_source(argv[2], seed, size, table);
+        printf("gen-atoms: %zu atoms, %zu slots, seed 0x%08x\n",
+               count, size, seed);
+        free(table);
+        return 0;
+      }
+    }
+    free(table);
+  }
+  fprintf(stderr, "gen-atoms: no perfect hash found\n");
+  return 1;
+}
@@ -0,0 +1,225 @@
+/*
+ * Multi-threaded stress test of libwapcaplet: several threads intern (one by
+ * one and in batches), ref, unref and caselessly compare strings from a
+ * shared pool at once. Half of
+ * the pool is kept referenced by the main thread, and every thread must get
+ * exactly those strings back when interning their text; the other half is
+ * interned and freed over and over, racing the final unref of one thread
+ * against the interning of another. At the end, the table must hold exactly
+ * what it held before the run (strings interned by constructors of whatever
+ * else is linked in). Exits non-zero on the first inconsistency. Run by
+ * build.sh after every build.
+ *
+ * usage: stress-intern [-i iterations] [threads]
+ */
+#include <libwapcaplet/libwapcaplet.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define POOL_SIZE 2048
+#define WINDOW 64  // references a thread holds on to at a time
+#define BATCH 16   // strings interned by one lwc_intern_strings call
+
+typedef struct {
+  char text[32];
+  size_t length;
+  char upper[32];    // |text| in upper case
+  lwc_string *pinned;  // referenced by main for the whole run, or NULL
+} pool_entry;
+
+static pool_entry pool_[POOL_SIZE];
+static long iterations_ = 200000;
+static volatile int failed_ = 0;
+
+
+static void fail(const char *what, const pool_entry *entry) {
+  fprintf(stderr, "stress-intern: %s (\"%s\")\n", what, entry->text);
+  failed_ = 1;
+}
+
+
+static uint32_t next_random(uint32_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+
+static void check_entry(const pool_entry *entry, int upper, lwc_string *str) {
+  const char *text = upper ? entry->upper : entry->text;
+  if (lwc_string_length(str) != entry->length ||
+      memcmp(lwc_string_data(str), text, entry->length) != 0)
+    fail("interned string has the wrong contents", entry);
+  if (!upper && entry->pinned && str != entry->pinned)
+    fail("interning a pinned string returned another string", entry);
+}
+
+
+static lwc_string *intern_entry(const pool_entry *entry, int upper) {
+  lwc_string *str = NULL;
+  const char *text = upper ? entry->upper : entry->text;
+  if (lwc_intern_string(text, entry->length, &str) != lwc_error_ok) {
+    fail("lwc_intern_string failed", entry);
+    return NULL;
+  }
+  check_entry(entry, upper, str);
+  return str;
+}
+
+
+// Intern BATCH random entries with one lwc_intern_strings call
+static void intern_batch(uint32_t *state) {
+  const pool_entry *entries[BATCH];
+  const char *texts[BATCH];
+  size_t lengths[BATCH];
+  lwc_string *strs[BATCH];
+  int k;
+  for (k = 0; k < BATCH; k++) {
+    entries[k] = &pool_[next_random(state) % POOL_SIZE];
+    texts[k] = entries[k]->text;
+    lengths[k] = entries[k]->length;
+  }
+  if (lwc_intern_strings(texts, lengths, BATCH, strs) != lwc_error_ok) {
+    fail("lwc_intern_strings failed", entries[0]);
+    return;
+  }
+  for (k = 0; k < BATCH; k++) {
+    check_entry(entries[k], 0, strs[k]);
+    lwc_string_unref(strs[k]);
+  }
+}
+
+
+static void *worker(void *arg) {
+  uint32_t state = (uint32_t)(uintptr_t)arg * 2654435761u + 1;
+  lwc_string *held[WINDOW];
+  const pool_entry *heldEntries[WINDOW];
+  long i;
+  int slot;
+
+  memset(held, 0, sizeof(held));
+  for (i = 0; i < iterations_ && !failed_; i++) {
+    const pool_entry *entry = &pool_[next_random(&state) % POOL_SIZE];
+    uint32_t op = next_random(&state) % 8;
+    lwc_string *str = intern_entry(entry, 0);
+    if (!str) break;
+
+    if (op == 0) {
+      // compare with the upper case spelling, creating caseless twins
+      lwc_string *upper = intern_entry(entry, 1);
+      bool equal = false;
+      if (!upper) break;
+      lwc_string *twin = NULL, *upperTwin = NULL;
+      if (lwc_string_caseless_isequal(str, upper, &equal) != lwc_error_ok ||
+          !equal)
+        fail("caseless comparison failed", entry);
+      if (lwc_string_caseless_twin(str, &twin) != lwc_error_ok ||
+          lwc_string_caseless_twin(upper, &upperTwin) != lwc_error_ok ||
+          twin != upperTwin)
+        fail("caseless twins differ", entry);
+      lwc_string_unref(upper);
+    } else if (op == 1) {
+      // extra references, dropped again right away
+      lwc_string_unref(lwc_string_ref(lwc_string_ref(str)));
+      lwc_string_unref(str);
+    } else if (op == 2) {
+      intern_batch(&state);
+    }
+
+    // keep the string for a while, dropping an older one in its place
+    slot = (int)(next_random(&state) % WINDOW);
+    if (held[slot]) {
+      if (lwc_string_length(held[slot]) != heldEntries[slot]->length)
+        fail("held string was freed", heldEntries[slot]);
+      lwc_string_unref(held[slot]);
+    }
+    held[slot] = str;
+    heldEntries[slot] = entry;
+  }
+
+  for (slot = 0; slot < WINDOW; slot++) {
+    if (held[slot]) lwc_string_unref(held[slot]);
+  }
+  return NULL;
+}
+
+
+static void count_string(lwc_string *str, void *pw) {
+  (void)str;
+  (*(size_t *)pw)++;
+}
+
+
+int main(int argc, char **argv) {
+  int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  int opt, t, i;
+  size_t before = 0, pinned = 0, left = 0;
+  pthread_t *ids;
+
+  while ((opt = getopt(argc, argv, "i:")) != -1) {
+    if (opt != 'i') {
+      fprintf(stderr, "usage: %s [-i iterations] [threads]\n", argv[0]);
+      return 1;
+    }
+    iterations_ = atol(optarg);
+  }
+  if (optind < argc) threads = atoi(argv[optind]);
+  if (threads < 2) threads = 2;
+  lwc_iterate_strings(count_string, &before);
+
+  for (i = 0; i < POOL_SIZE; i++) {
+    pool_entry *entry = &pool_[i];
+    size_t k;
+    entry->length = (size_t)snprintf(entry->text, sizeof(entry->text),
+                                     "%s-%d", i % 3 ? "class" : "Id", i);
+    for (k = 0; k <= entry->length; k++) {
+      char c = entry->text[k];
+      entry->upper[k] = (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+    }
+    if (i % 2 == 0) {
+      entry->pinned = intern_entry(entry, 0);
+      if (!entry->pinned) return 1;
+      pinned++;
+    }
+  }
+
+  ids = malloc(sizeof(pthread_t) * (size_t)threads);
+  if (!ids) return 1;
+  for (t = 0; t < threads; t++) {
+    if (pthread_create(&ids[t], NULL, worker, (void *)(uintptr_t)(t + 1))) {
+      fprintf(stderr, "stress-intern: pthread_create failed\n");
+      return 1;
+    }
+  }
+  for (t = 0; t < threads; t++)
+    pthread_join(ids[t], NULL);
+  free(ids);
+  if (failed_) return 1;
+
+  // what is left are the pinned strings and the lowercase twins of those
+  // which were compared with their upper case spelling, all of which are
+  // their own twins (everything in the pool starting with "Id" is not)
+  lwc_iterate_strings(count_string, &left);
+  for (i = 0; i < POOL_SIZE; i++) {
+    if (pool_[i].pinned) lwc_string_unref(pool_[i].pinned);
+  }
+  if (left < before + pinned) {
+    fprintf(stderr, "stress-intern: %zu strings left, expected at least "
+            "%zu\n", left, before + pinned);
+    return 1;
+  }
+  left = 0;
+  lwc_iterate_strings(count_string, &left);
+  if (left != before) {
+    fprintf(stderr, "stress-intern: %zu strings leaked\n", left - before);
+    return 1;
+  }
+  printf("stress-intern: %d threads x %ld iterations ok\n", threads,
+         iterations_);
+  return 0;
+}
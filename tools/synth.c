@@ -0,0 +1,389 @@
+#include "synth.h"
+#include "../cocoa-framework/CSSSelectHandlerBase.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *element_names[] = {
+  "html", "body", "div", "span", "p", "a", "ul", "ol", "li", "table", "tr",
+  "td", "th", "h1", "h2", "h3", "img", "em", "strong", "form", "input",
+  "label", "button", "section", "header", "footer", "nav", "pre", "code",
+  "blockquote",
+};
+#define N_ELEMENT_NAMES (sizeof(element_names) / sizeof(element_names[0]))
+#define N_CLASS_NAMES 64
+#define N_IDS 256
+
+static lwc_string *vocab_elements[N_ELEMENT_NAMES];
+static lwc_string *vocab_classes[N_CLASS_NAMES];
+static lwc_string *vocab_ids[N_IDS];
+static bool vocab_ready = false;
+
+uint64_t synth_alloc_calls = 0;
+
+
+void *synth_realloc(void *ptr, size_t size, void *pw) {
+  (void)pw;
+  if (size == 0) {
+    free(ptr);
+    return NULL;
+  }
+  synth_alloc_calls++;
+  return realloc(ptr, size);
+}
+
+
+unsigned synth_rand(unsigned *state) {
+  *state = *state * 1103515245u + 12345u;
+  return (*state >> 16) & 0x7fff;
+}
+
+
+static bool intern_vocabulary(void) {
+  char buf[32];
+  size_t i;
+  if (vocab_ready)
+    return true;
+  for (i = 0; i < N_ELEMENT_NAMES; i++) {
+    if (lwc_intern_string(element_names[i], strlen(element_names[i]),
+                          &vocab_elements[i]) != lwc_error_ok)
+      return false;
+  }
+  for (i = 0; i < N_CLASS_NAMES; i++) {
+    int len = snprintf(buf, sizeof(buf), "c%zu", i);
+    if (lwc_intern_string(buf, (size_t)len, &vocab_classes[i]) != lwc_error_ok)
+      return false;
+  }
+  for (i = 0; i < N_IDS; i++) {
+    int len = snprintf(buf, sizeof(buf), "i%zu", i);
+    if (lwc_intern_string(buf, (size_t)len, &vocab_ids[i]) != lwc_error_ok)
+      return false;
+  }
+  vocab_ready = true;
+  return true;
+}
+
+
+bool synth_tree_create(synth_tree *tree, size_t count, unsigned seed) {
+  size_t i;
+  uint32_t c;
+  if (count == 0 || !intern_vocabulary())
+    return false;
+  tree->nodes = calloc(count, sizeof(synth_node));
+  if (tree->nodes == NULL)
+    return false;
+  tree->count = count;
+
+  for (i = 0; i < count; i++) {
+    synth_node *node = &tree->nodes[i];
+    node->name = lwc_string_ref(
+        vocab_elements[i == 0 ? 0 : synth_rand(&seed) % N_ELEMENT_NAMES]);
+    if (synth_rand(&seed) % 8 == 0)
+      node->id = lwc_string_ref(vocab_ids[synth_rand(&seed) % N_IDS]);
+    node->n_classes = synth_rand(&seed) % 4;
+    if (node->n_classes) {
+      node->classes = malloc(node->n_classes * sizeof(lwc_string *));
+      if (node->classes == NULL) {
+        tree->count = i + 1;
+        node->n_classes = 0;
+        synth_tree_destroy(tree);
+        return false;
+      }
+      for (c = 0; c < node->n_classes; c++) {
+        node->classes[c] =
+            lwc_string_ref(vocab_classes[synth_rand(&seed) % N_CLASS_NAMES]);
+      }
+    }
+    // attach to one of the most recent nodes, giving a bushy tree of
+    // moderate depth with plenty of siblings
+    if (i > 0) {
+      size_t back = 1 + synth_rand(&seed) % (i < 6 ? i : 6);
+      synth_node *parent = &tree->nodes[i - back];
+      node->parent = parent;
+      node->prev_sibling = parent->last_child;
+      parent->last_child = node;
+    }
+  }
+  return true;
+}
+
+
+void synth_tree_destroy(synth_tree *tree) {
+  size_t i;
+  uint32_t c;
+  for (i = 0; i < tree->count; i++) {
+    synth_node *node = &tree->nodes[i];
+    lwc_string_unref(node->name);
+    if (node->id)
+      lwc_string_unref(node->id);
+    for (c = 0; c < node->n_classes; c++)
+      lwc_string_unref(node->classes[c]);
+    free(node->classes);
+  }
+  free(tree->nodes);
+  tree->nodes = NULL;
+  tree->count = 0;
+}
+
+
+// --------------------------------------------------------------------------
+// Selection handler
+
+
+static bool name_matches(synth_node *node, lwc_string *name) {
+  bool match = false;
+  return lwc_string_caseless_isequal(node->name, name, &match) ==
+         lwc_error_ok && match;
+}
+
+static css_error node_name(void *pw, void *n, lwc_string **name) {
+  (void)pw;
+  *name = lwc_string_ref(((synth_node *)n)->name);
+  return CSS_OK;
+}
+
+static css_error node_classes(void *pw, void *n, lwc_string ***classes,
+                              uint32_t *n_classes) {
+  synth_node *node = n;
+  uint32_t i;
+  (void)pw;
+  *classes = NULL;
+  *n_classes = 0;
+  if (node->n_classes == 0)
+    return CSS_OK;
+  // libcss unrefs the strings and frees the array with the ctx allocator
+  *classes = synth_realloc(NULL, node->n_classes * sizeof(lwc_string *), NULL);
+  if (*classes == NULL)
+    return CSS_NOMEM;
+  for (i = 0; i < node->n_classes; i++)
+    (*classes)[i] = lwc_string_ref(node->classes[i]);
+  *n_classes = node->n_classes;
+  return CSS_OK;
+}
+
+static css_error node_id(void *pw, void *n, lwc_string **id) {
+  synth_node *node = n;
+  (void)pw;
+  *id = node->id ? lwc_string_ref(node->id) : NULL;
+  return CSS_OK;
+}
+
+static css_error named_ancestor_node(void *pw, void *n, lwc_string *name,
+                                     void **ancestor) {
+  synth_node *node = ((synth_node *)n)->parent;
+  (void)pw;
+  while (node && !name_matches(node, name))
+    node = node->parent;
+  *ancestor = node;
+  return CSS_OK;
+}
+
+static css_error named_parent_node(void *pw, void *n, lwc_string *name,
+                                   void **parent) {
+  synth_node *node = ((synth_node *)n)->parent;
+  (void)pw;
+  *parent = (node && name_matches(node, name)) ? node : NULL;
+  return CSS_OK;
+}
+
+static css_error named_sibling_node(void *pw, void *n, lwc_string *name,
+                                    void **sibling) {
+  synth_node *node = ((synth_node *)n)->prev_sibling;
+  (void)pw;
+  *sibling = (node && name_matches(node, name)) ? node : NULL;
+  return CSS_OK;
+}
+
+static css_error parent_node(void *pw, void *n, void **parent) {
+  (void)pw;
+  *parent = ((synth_node *)n)->parent;
+  return CSS_OK;
+}
+
+static css_error sibling_node(void *pw, void *n, void **sibling) {
+  (void)pw;
+  *sibling = ((synth_node *)n)->prev_sibling;
+  return CSS_OK;
+}
+
+static css_error node_has_name(void *pw, void *n, lwc_string *name,
+                               bool *match) {
+  (void)pw;
+  *match = name_matches(n, name);
+  return CSS_OK;
+}
+
+static css_error node_has_class(void *pw, void *n, lwc_string *name,
+                                bool *match) {
+  synth_node *node = n;
+  uint32_t i;
+  (void)pw;
+  *match = false;
+  for (i = 0; i < node->n_classes && !*match; i++)
+    *match = (node->classes[i] == name);
+  return CSS_OK;
+}
+
+static css_error node_has_id(void *pw, void *n, lwc_string *name,
+                             bool *match) {
+  (void)pw;
+  *match = (((synth_node *)n)->id == name);
+  return CSS_OK;
+}
+
+static css_error node_is_first_child(void *pw, void *n, bool *match) {
+  (void)pw;
+  *match = (((synth_node *)n)->prev_sibling == NULL);
+  return CSS_OK;
+}
+
+
+void synth_handler_init(css_select_handler *handler) {
+  CSSSelectHandlerInitToBase(handler);
+  handler->node_name = node_name;
+  handler->node_classes = node_classes;
+  handler->node_id = node_id;
+  handler->named_ancestor_node = named_ancestor_node;
+  handler->named_parent_node = named_parent_node;
+  handler->named_sibling_node = named_sibling_node;
+  handler->parent_node = parent_node;
+  handler->sibling_node = sibling_node;
+  handler->node_has_name = node_has_name;
+  handler->node_has_class = node_has_class;
+  handler->node_has_id = node_has_id;
+  handler->node_is_first_child = node_is_first_child;
+}
+
+
+// --------------------------------------------------------------------------
+// Stylesheets
+
+
+typedef struct {
+  char *data;
+  size_t length;
+  size_t capacity;
+  bool failed;
+} buffer;
+
+static void buffer_printf(buffer *b, const char *format, ...) {
+  va_list ap;
+  int n;
+  if (b->failed)
+    return;
+  while (1) {
+    size_t avail = b->capacity - b->length;
+    va_start(ap, format);
+    n = vsnprintf(b->data + b->length, avail, format, ap);
+    va_end(ap);
+    if (n < 0) {
+      b->failed = true;
+      return;
+    }
+    if ((size_t)n < avail)
+      break;
+    size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+    while (capacity - b->length <= (size_t)n)
+      capacity *= 2;
+    char *data = realloc(b->data, capacity);
+    if (data == NULL) {
+      b->failed = true;
+      return;
+    }
+    b->data = data;
+    b->capacity = capacity;
+  }
+  b->length += (size_t)n;
+}
+
+static void simple_selector(buffer *b, unsigned *seed) {
+  unsigned kind = synth_rand(seed) % 10;
+  const char *element = element_names[synth_rand(seed) % N_ELEMENT_NAMES];
+  if (kind < 4) {
+    buffer_printf(b, "%s", element);
+  } else if (kind < 7) {
+    buffer_printf(b, "%s.c%u", kind == 4 ? "" : element,
+                  synth_rand(seed) % N_CLASS_NAMES);
+  } else if (kind < 8) {
+    buffer_printf(b, "#i%u", synth_rand(seed) % N_IDS);
+  } else if (kind < 9) {
+    buffer_printf(b, "%s:first-child", element);
+  } else {
+    buffer_printf(b, "%s:hover", element);
+  }
+}
+
+static const char *combinators[] = { " ", " > ", " + ", " " };
+
+static const char *declarations[] = {
+  "color: #%06x;",
+  "background-color: rgb(%u, 12, 200);",
+  "margin: %upx 4px 0 2em;",
+  "padding: 0.%uem;",
+  "font-family: \"Helvetica Neue\", Arial, sans-serif; font-size: %upx;",
+  "font: bold %upt/1.4 Georgia, serif;",
+  "border: %upx solid #ccc;",
+  "width: %u%%; height: auto;",
+  "line-height: 1.%u;",
+  "text-decoration: underline; z-index: %u;",
+  "background: url(\"images/bg%u.png\") no-repeat 0 0;",
+  "display: block; float: left; clear: both; /* %u */",
+};
+#define N_DECLARATIONS (sizeof(declarations) / sizeof(declarations[0]))
+
+char *synth_stylesheet(size_t rules, unsigned seed, size_t *length) {
+  buffer b = { NULL, 0, 0, false };
+  size_t r;
+  unsigned i, n;
+  for (r = 0; r < rules && !b.failed; r++) {
+    // selector group of 1-3 selectors with up to 3 compound parts each
+    n = 1 + synth_rand(&seed) % 3;
+    for (i = 0; i < n; i++) {
+      unsigned parts = 1 + synth_rand(&seed) % 3;
+      if (i)
+        buffer_printf(&b, ",\n");
+      while (parts--) {
+        simple_selector(&b, &seed);
+        if (parts)
+          buffer_printf(&b, "%s", combinators[synth_rand(&seed) % 4]);
+      }
+    }
+    buffer_printf(&b, " {\n");
+    n = 1 + synth_rand(&seed) % 5;
+    for (i = 0; i < n; i++) {
+      buffer_printf(&b, "  ");
+      buffer_printf(&b, declarations[synth_rand(&seed) % N_DECLARATIONS],
+                    synth_rand(&seed) % 100);
+      buffer_printf(&b, "\n");
+    }
+    buffer_printf(&b, "}\n\n");
+  }
+  if (b.failed) {
+    free(b.data);
+    return NULL;
+  }
+  *length = b.length;
+  return b.data;
+}
+
+
+uint8_t *synth_read_file(const char *path, size_t *length) {
+  FILE *fp = fopen(path, "rb");
+  uint8_t *data = NULL;
+  long size;
+  if (fp == NULL)
+    return NULL;
+  if (fseek(fp, 0, SEEK_END) == 0 && (size = ftell(fp)) >= 0 &&
+      fseek(fp, 0, SEEK_SET) == 0 && (data = malloc((size_t)size + 1))) {
+    if (fread(data, 1, (size_t)size, fp) == (size_t)size) {
+      *length = (size_t)size;
+    } else {
+      free(data);
+      data = NULL;
+    }
+  }
+  fclose(fp);
+  return data;
+}
@@ -0,0 +1,55 @@
+/*
+ * Synthetic documents and stylesheets for driving libcss outside of a real
+ * DOM. Used by the PGO training driver.
+ *
+ * Copyright 2010 Rasmus Andersson <http://hunch.se/>
+ * Licensed under the MIT license.
+ */
+#ifndef CSS_TOOLS_SYNTH_H_
+#define CSS_TOOLS_SYNTH_H_
+
+#include <libcss/libcss.h>
+
+typedef struct synth_node {
+  lwc_string *name;
+  lwc_string *id;  // may be NULL
+  lwc_string **classes;
+  uint32_t n_classes;
+  struct synth_node *parent;
+  struct synth_node *prev_sibling;
+  struct synth_node *last_child;
+} synth_node;
+
+typedef struct synth_tree {
+  synth_node *nodes;  // document order; nodes[0] is the root
+  size_t count;
+} synth_tree;
+
+/// Allocator passed to libcss by the tools. Also used for the arrays handed
+/// out by the |node_classes| handler, which libcss frees with it.
+void *synth_realloc(void *ptr, size_t size, void *pw);
+
+/// Number of allocating (malloc or realloc, not free) synth_realloc calls
+extern uint64_t synth_alloc_calls;
+
+/// Deterministic pseudo-random numbers, so runs are repeatable
+unsigned synth_rand(unsigned *state);
+
+/// Build a tree of |count| nodes. Returns false on allocation failure.
+bool synth_tree_create(synth_tree *tree, size_t count, unsigned seed);
+void synth_tree_destroy(synth_tree *tree);
+
+/// Initialize |handler| to a CSSSelectHandlerBase-derived handler which
+/// matches synth_node objects.
+void synth_handler_init(css_select_handler *handler);
+
+/**
+ * Generate a stylesheet of |rules| rules using the same vocabulary as
+ * synth_tree_create. Returns a malloc'd buffer of |*length| bytes, or NULL.
+ */
+char *synth_stylesheet(size_t rules, unsigned seed, size_t *length);
+
+/// Read a whole file into a malloc'd buffer. Returns NULL on failure.
+uint8_t *synth_read_file(const char *path, size_t *length);
+
+#endif  // CSS_TOOLS_SYNTH_H_
@@ -0,0 +1,79 @@
+/*
+ * Loads stylesheets from files, including an empty one, both with
+ * -loadContentsOfFile:withCallback: and as file: URLs through
+ * -loadFromRepresentedURLWithCallback:, and checks that each loads without
+ * an error. Run by build.sh after every build on OS X.
+ *
+ * usage: test-load-file
+ */
+#import <CSS/CSS.h>
+
+static int failed_ = 0;
+
+
+static void check(NSString *what, NSString *path, NSError *error) {
+  if (error) {
+    fprintf(stderr, "test-load-file: %s of %s failed: %s\n",
+            [what UTF8String], [[path lastPathComponent] UTF8String],
+            [[error localizedDescription] UTF8String]);
+    failed_ = 1;
+  }
+}
+
+
+static void load(NSString *path) {
+  CSSStylesheet *sheet = [[CSSStylesheet alloc] initWithURL:nil];
+  __block BOOL called = NO;
+  __block NSError *error = nil;
+  [sheet loadContentsOfFile:path withCallback:^(NSError *e) {
+    called = YES;
+    error = [e retain];
+  }];
+  check(@"-loadContentsOfFile:", path, called ? error :
+        [NSError errorWithDomain:@"test" code:1 userInfo:nil]);
+  [error release];
+  [sheet release];
+
+  // calls back on a global queue
+  sheet = [[CSSStylesheet alloc] initWithURL:[NSURL fileURLWithPath:path]];
+  dispatch_semaphore_t done = dispatch_semaphore_create(0);
+  __block NSError *urlError = nil;
+  BOOL started = [sheet loadFromRepresentedURLWithCallback:^(NSError *e) {
+    urlError = [e retain];
+    dispatch_semaphore_signal(done);
+  }];
+  if (started) {
+    dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+    check(@"-loadFromRepresentedURLWithCallback:", path, urlError);
+  } else {
+    check(@"-loadFromRepresentedURLWithCallback:", path,
+          [NSError errorWithDomain:@"test" code:2 userInfo:nil]);
+  }
+  [urlError release];
+  dispatch_release(done);
+  [sheet release];
+}
+
+
+int main(int argc, char **argv) {
+  NSAutoreleasePool *pool = [NSAutoreleasePool new];
+  NSString *dir = [NSTemporaryDirectory() stringByAppendingPathComponent:
+      [NSString stringWithFormat:@"test-load-file.%d", getpid()]];
+  [[NSFileManager defaultManager] createDirectoryAtPath:dir
+                            withIntermediateDirectories:YES
+                                             attributes:nil
+                                                  error:NULL];
+  NSString *empty = [dir stringByAppendingPathComponent:@"empty.css"];
+  NSString *sheet = [dir stringByAppendingPathComponent:@"sheet.css"];
+  [[NSData data] writeToFile:empty atomically:NO];
+  [[@"p { color: red }" dataUsingEncoding:NSUTF8StringEncoding]
+      writeToFile:sheet atomically:NO];
+
+  load(empty);
+  load(sheet);
+
+  [[NSFileManager defaultManager] removeItemAtPath:dir error:NULL];
+  if (!failed_) printf("test-load-file: ok\n");
+  [pool drain];
+  return failed_;
+}
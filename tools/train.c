@@ -0,0 +1,170 @@
+/*
+ * PGO training driver. Grown out of libcss's examples/example1.c: parses the
+ * stylesheets given on the command line (plus a large generated one) in
+ * several chunkings, then selects and composes styles for synthetic trees.
+ *
+ * usage: train [-i iterations] [-n nodes] [stylesheet.css ...]
+ */
+#include "synth.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SHEETS 64
+
+static void die(const char *text, css_error code) {
+  fprintf(stderr, "train: %s: %s\n", text, css_error_to_string(code));
+  exit(1);
+}
+
+static css_error resolve_url(void *pw, const char *base, lwc_string *rel,
+                             lwc_string **abs) {
+  (void)pw; (void)base;
+  *abs = lwc_string_ref(rel);
+  return CSS_OK;
+}
+
+static css_stylesheet *parse(const uint8_t *data, size_t length,
+                             size_t chunk) {
+  css_stylesheet *sheet;
+  css_error code;
+  size_t offset;
+
+  code = css_stylesheet_create(CSS_LEVEL_DEFAULT, "UTF-8", "", NULL,
+      false, false, synth_realloc, NULL, resolve_url, NULL, NULL, NULL,
+      &sheet);
+  if (code != CSS_OK)
+    die("css_stylesheet_create", code);
+
+  for (offset = 0; offset < length; offset += chunk) {
+    size_t n = length - offset < chunk ? length - offset : chunk;
+    code = css_stylesheet_append_data(sheet, data + offset, n);
+    if (code != CSS_OK && code != CSS_NEEDDATA)
+      die("css_stylesheet_append_data", code);
+  }
+  code = css_stylesheet_data_done(sheet);
+  // imports are not followed; an unresolved @import is not an error here
+  if (code != CSS_OK && code != CSS_IMPORTS_PENDING)
+    die("css_stylesheet_data_done", code);
+  return sheet;
+}
+
+static void select_tree(css_select_ctx *ctx, css_select_handler *handler,
+                        size_t count, unsigned seed) {
+  synth_tree tree;
+  css_computed_style **computed;
+  css_error code;
+  size_t i;
+
+  if (!synth_tree_create(&tree, count, seed))
+    die("synth_tree_create", CSS_NOMEM);
+  computed = calloc(tree.count, sizeof(css_computed_style *));
+  if (computed == NULL)
+    die("calloc", CSS_NOMEM);
+
+  for (i = 0; i < tree.count; i++) {
+    synth_node *node = &tree.nodes[i];
+    css_computed_style *style;
+    code = css_computed_style_create(synth_realloc, NULL, &style);
+    if (code != CSS_OK)
+      die("css_computed_style_create", code);
+    code = css_select_style(ctx, node, 0, CSS_MEDIA_SCREEN, NULL, style,
+                            handler, NULL);
+    if (code != CSS_OK)
+      die("css_select_style", code);
+
+    if (node->parent == NULL) {
+      computed[i] = style;
+      continue;
+    }
+    // parents always precede their children in document order
+    code = css_computed_style_create(synth_realloc, NULL, &computed[i]);
+    if (code != CSS_OK)
+      die("css_computed_style_create", code);
+    code = css_computed_style_compose(computed[node->parent - tree.nodes],
+        style, handler->compute_font_size, NULL, computed[i]);
+    if (code != CSS_OK)
+      die("css_computed_style_compose", code);
+    css_computed_style_destroy(style);
+  }
+
+  for (i = 0; i < tree.count; i++)
+    css_computed_style_destroy(computed[i]);
+  free(computed);
+  synth_tree_destroy(&tree);
+}
+
+int main(int argc, char **argv) {
+  static const size_t chunks[] = { 1 << 20, 4096, 61 };
+  css_stylesheet *sheets[MAX_SHEETS];
+  size_t n_sheets = 0;
+  css_select_handler handler;
+  css_select_ctx *ctx;
+  css_error code;
+  int iterations = 3;
+  size_t nodes = 5000;
+  int opt, it;
+  size_t i, c;
+
+  while ((opt = getopt(argc, argv, "i:n:")) != -1) {
+    switch (opt) {
+      case 'i': iterations = atoi(optarg); break;
+      case 'n': nodes = (size_t)strtoul(optarg, NULL, 10); break;
+      default:
+        fprintf(stderr, "usage: %s [-i iterations] [-n nodes] "
+                        "[stylesheet.css ...]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  synth_handler_init(&handler);
+
+  for (it = 0; it < iterations; it++) {
+    size_t length;
+    uint8_t *data;
+
+    // parse: corpus files followed by a generated sheet
+    for (i = optind; i <= (size_t)argc && n_sheets < MAX_SHEETS; i++) {
+      if (i < (size_t)argc) {
+        data = synth_read_file(argv[i], &length);
+        if (data == NULL) {
+          perror(argv[i]);
+          return 1;
+        }
+      } else {
+        data = (uint8_t *)synth_stylesheet(2000, (unsigned)it + 1, &length);
+        if (data == NULL)
+          die("synth_stylesheet", CSS_NOMEM);
+      }
+      for (c = 0; c < sizeof(chunks) / sizeof(chunks[0]); c++) {
+        css_stylesheet *sheet = parse(data, length, chunks[c]);
+        if (c == 0)
+          sheets[n_sheets++] = sheet;
+        else
+          css_stylesheet_destroy(sheet);
+      }
+      free(data);
+    }
+
+    // select + compose
+    code = css_select_ctx_create(synth_realloc, NULL, &ctx);
+    if (code != CSS_OK)
+      die("css_select_ctx_create", code);
+    for (i = 0; i < n_sheets; i++) {
+      code = css_select_ctx_append_sheet(ctx, sheets[i], CSS_ORIGIN_AUTHOR,
+                                         CSS_MEDIA_ALL);
+      if (code != CSS_OK)
+        die("css_select_ctx_append_sheet", code);
+    }
+    select_tree(ctx, &handler, nodes, (unsigned)it + 1);
+    css_select_ctx_destroy(ctx);
+
+    for (i = 0; i < n_sheets; i++)
+      css_stylesheet_destroy(sheets[i]);
+    n_sheets = 0;
+  }
+
+  return 0;
+}